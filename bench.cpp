@@ -1,9 +1,57 @@
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstdlib>
 #include <filesystem>
+#include <new>
 
 #include "sfc_comp.hpp"
 
-#define P(x) std::pair(#x, x)
+// Counts the bytes allocated through the global operator new, so that the peak heap usage of each
+// compressor can be reported along with its running time.
+namespace heap {
+
+std::atomic<size_t> current = 0;
+std::atomic<size_t> peak = 0;
+
+void* allocate(size_t size, size_t align) {
+  align = std::max<size_t>(align, 2 * sizeof(void*));
+  const auto raw = static_cast<char*>(std::malloc(size + 2 * align));
+  if (!raw) throw std::bad_alloc();
+  const auto p = raw + align + (align - uintptr_t(raw) % align) % align;
+  reinterpret_cast<void**>(p)[-1] = raw;
+  reinterpret_cast<size_t*>(p)[-2] = size;
+  const size_t cur = current += size;
+  for (size_t pk = peak; pk < cur && !peak.compare_exchange_weak(pk, cur); );
+  return p;
+}
+
+void deallocate(void* p) noexcept {
+  if (!p) return;
+  current -= reinterpret_cast<size_t*>(p)[-2];
+  std::free(reinterpret_cast<void**>(p)[-1]);
+}
+
+size_t reset_peak() {
+  return peak = current.load();
+}
+
+} // namespace heap
+
+void* operator new(size_t size) { return heap::allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void* operator new[](size_t size) { return heap::allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void* operator new(size_t size, std::align_val_t al) { return heap::allocate(size, size_t(al)); }
+void* operator new[](size_t size, std::align_val_t al) { return heap::allocate(size, size_t(al)); }
+void operator delete(void* p) noexcept { heap::deallocate(p); }
+void operator delete[](void* p) noexcept { heap::deallocate(p); }
+void operator delete(void* p, size_t) noexcept { heap::deallocate(p); }
+void operator delete[](void* p, size_t) noexcept { heap::deallocate(p); }
+void operator delete(void* p, std::align_val_t) noexcept { heap::deallocate(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { heap::deallocate(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { heap::deallocate(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { heap::deallocate(p); }
+
+#define P(x) std::pair(#x, &x)
 
 void benchmark(const std::string& path) {
   // Ref
@@ -174,10 +222,10 @@ void benchmark(const std::string& path) {
       return paths[a] < paths[b];
     });
     for (const auto& i : orders) printf(" %s |", paths[i].c_str());
-    puts(" Total Size | Running Time | Hash |");
+    puts(" Total Size | Peak Heap (KiB) | Running Time | Hash |");
 
     printf("|");
-    for (size_t i = 0; i < inputs.size() + 4; ++i) {
+    for (size_t i = 0; i < inputs.size() + 5; ++i) {
       printf(" :--- |");
     }
     puts("");
@@ -188,7 +236,7 @@ void benchmark(const std::string& path) {
       printf(" %4zX |", inputs[i].size());
       s += inputs[i].size();
     }
-    printf(" %6zX | ------ | -------- |\n", s);
+    printf(" %6zX | ------ | ------ | -------- |\n", s);
   }
 
   uint32_t total_hash = 0;
@@ -199,6 +247,7 @@ void benchmark(const std::string& path) {
     const auto& comp = p_comps[c];
     printf("| %-40s | ", comp.first);
 
+    const size_t heap_beg = heap::reset_peak();
     const auto beg = high_resolution_clock::now();
     size_t total_size = 0;
 
@@ -218,7 +267,7 @@ void benchmark(const std::string& path) {
     total_size_sum += total_size;
 
     const auto end = high_resolution_clock::now();
-    printf("%6zX | %.4f | %08X |\n", total_size,
+    printf("%6zX | %zu | %.4f | %08X |\n", total_size, (heap::peak - heap_beg) >> 10,
             duration_cast<nanoseconds>(end - beg).count() / 1e9, h);
   }
   printf("%zX : %08X\n", total_size_sum, total_hash);
@@ -229,9 +278,14 @@ void benchmark(const std::string& path) {
 int main(int argc, char** argv) {
   using namespace std::chrono;
   if (argc < 2) {
-    printf("Usage: %s <input-dir>\n", argv[0]);
+    printf("Usage: %s <input-dir> [threads] [level]\n", argv[0]);
     return 1;
   } else {
+    if (argc >= 3) {
+      sfc_comp::parallel::set_threads(std::stoul(argv[2]));
+      sfc_comp::parallel::set_min_size(0);
+    }
+    const sfc_comp::level::scope level(argc >= 4 ? std::stoul(argv[3]) : sfc_comp::level::optimal);
     const auto beg = high_resolution_clock::now();
     benchmark(argv[1]);
     const auto end = high_resolution_clock::now();
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
+#include <atomic>
+#include <chrono>
 #include <string>
 #include <vector>
 
@@ -16,6 +19,108 @@ void save(const std::string&, std::span<const uint8_t>);
 
 } // namespace io
 
+namespace parallel {
+
+// Sets the number of threads used for building the suffix array and lcp (0: all cores).
+// The default is 1, i.e. everything runs on the calling thread.
+void set_threads(size_t threads);
+
+// Inputs smaller than `size` bytes are always processed on the calling thread.
+void set_min_size(size_t size);
+
+} // namespace parallel
+
+namespace analysis {
+
+// While a scope is alive, the suffix array, rank and lcp built for an input are kept
+// (up to `capacity` inputs) and reused by later compressions of identical inputs,
+// e.g. when trying several formats on the same data.
+class scope {
+ public:
+  explicit scope(size_t capacity = 8);
+  ~scope();
+  scope(const scope&) = delete;
+  scope& operator = (const scope&) = delete;
+
+ private:
+  size_t prev_capacity;
+};
+
+} // namespace analysis
+
+namespace level {
+
+// Parsers from the fastest to the one with the best ratio.
+// Below level::optimal, the formats that only need the longest match at each position (or of each
+// offset bucket) take it from a hash-chain matcher instead of the suffix array, so it may be shorter.
+// The lzss-based formats also parse greedily; the others keep their parse over those matches.
+// Formats that do not search for lz matches always use the optimal parse (see `result::level`).
+inline constexpr size_t greedy = 0;  // the longest match of 8 hash-chain candidates, taken at each position
+inline constexpr size_t lazy = 1;    // 32 candidates, and a match is deferred if the next position has a longer one
+inline constexpr size_t optimal = 2; // the shortest output of the format (default)
+
+// While a scope is alive, compressions on the calling thread use the given level
+// (including the work they hand to other threads).
+class scope {
+ public:
+  explicit scope(size_t level);
+  ~scope();
+  scope(const scope&) = delete;
+  scope& operator = (const scope&) = delete;
+
+ private:
+  size_t prev_level;
+};
+
+} // namespace level
+
+// Iterations of the loops that solve with estimated code lengths, rebuild the codes
+// (e.g. Huffman tables) from the result and solve again.
+struct refine_stats {
+  std::vector<size_t> iterations; // per loop (a format may run one loop per chunk)
+  std::vector<double> seconds;    // per iteration, in the order they ran
+};
+
+// Cancels the compressions whose options refer to it (e.g. from another thread).
+class cancel_token {
+ public:
+  void cancel() { flag.store(true, std::memory_order_relaxed); }
+  bool cancelled() const { return flag.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<bool> flag = false;
+};
+
+struct options {
+  size_t level = level::optimal;
+
+  // Limits of the loops above (0: no limit). They stop early once a result has been kept,
+  // so that the output is valid but may be larger.
+  size_t max_iterations = 0;
+  double time_budget = 0; // seconds per loop
+
+  // At the deadline, or once `cancel` is cancelled, the loops above and the parameter sweeps
+  // (e.g. dokapon_comp) stop at their next step and return the best valid output found so far.
+  // Loops with a fixed schedule (e.g. rareware_comp) jump to their final step.
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+  const cancel_token* cancel = nullptr;
+
+  // If not null, the loops append their iteration counts and timings to it.
+  refine_stats* stats = nullptr;
+};
+
+struct result {
+  std::vector<uint8_t> out;
+  bool complete = true; // false if the deadline or `options::cancel` cut the compression short
+  // The level that was applied: `options::level` if the format (or a part of it) has a cheaper
+  // parser for it, level::optimal otherwise.
+  size_t level = level::optimal;
+};
+
+// Compresses `input` with `comp` under the given options.
+result compress(std::vector<uint8_t> (*comp)(std::span<const uint8_t>),
+                std::span<const uint8_t> input, const options& opts);
+
 std::vector<uint8_t> action_pachio_comp(std::span<const uint8_t>);
 std::vector<uint8_t> addams_family_comp(std::span<const uint8_t>);
 std::vector<uint8_t> asameshimae_nyanko_comp(std::span<const uint8_t>);
@@ -0,0 +1,187 @@
+#include <cassert>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+
+#include "sfc_comp.hpp"
+
+#include "lz.hpp"
+
+// Measures encode::lz::find on the segment tree layouts of the lz helpers, with single and
+// batched queries.
+// Each pass queries every position of the input, either while adding the positions in order
+// (as `lz_helper` does without `updated`) or on a tree that already holds every position.
+
+namespace {
+
+using namespace sfc_comp;
+using index_type = uint32_t;
+using offset_type = std::make_signed_t<index_type>;
+
+struct pass_result {
+  double qps;
+  size_t hash;
+};
+
+struct query {
+  size_t pos;
+  size_t max_dist;
+  size_t min_len;
+};
+
+template <template <typename> typename Tree>
+class layout {
+ public:
+  layout(std::span<const index_type> sa, std::span<const index_type> lcp)
+      : lcp(lcp), full(sa.size()) {
+    full.init([&](size_t i) { return offset_type(sa[i]); });
+  }
+
+  template <typename Func>
+  static pass_result run(size_t queries, Func&& func) {
+    using namespace std::chrono;
+    const auto beg = high_resolution_clock::now();
+    const size_t hash = func();
+    const auto end = high_resolution_clock::now();
+    return {queries / (duration_cast<nanoseconds>(end - beg).count() / 1e9), hash};
+  }
+
+  pass_result forward(std::span<const index_type> rank, size_t max_dist) const {
+    return run(rank.size(), [&] {
+      Tree<range_max<offset_type>> seg(rank.size());
+      size_t hash = 0;
+      for (size_t i = 0; i < rank.size(); ++i) {
+        const auto res = encode::lz::find(i, rank[i], max_dist, 3, lcp, seg);
+        hash = hash * 31 + res.ofs * 0x10001 + res.len;
+        seg.update(rank[i], i);
+      }
+      return hash;
+    });
+  }
+
+  pass_result static_tree(std::span<const index_type> rank, size_t max_dist) const {
+    return run(rank.size(), [&] {
+      size_t hash = 0;
+      for (size_t i = 0; i < rank.size(); ++i) {
+        const auto res = encode::lz::find(i, rank[i], max_dist, 3, lcp, full);
+        hash = hash * 31 + res.ofs * 0x10001 + res.len;
+      }
+      return hash;
+    });
+  }
+
+  // Same as `static_tree` for independent queries, prefetching the rank of a query and then its
+  // leaves `prefetch_distance` queries before answering it.
+  pass_result batch(std::span<const index_type> rank, std::span<const query> queries) const {
+    return run(queries.size(), [&] {
+      std::vector<encode::lz_data> dest(queries.size());
+      find(rank, queries, dest);
+      size_t hash = 0;
+      for (const auto& res : dest) hash = hash * 31 + res.ofs * 0x10001 + res.len;
+      return hash;
+    });
+  }
+
+ private:
+  static constexpr size_t prefetch_distance = 8;
+
+  void find(std::span<const index_type> rank, std::span<const query> queries,
+      std::span<encode::lz_data> dest) const {
+    assert(dest.size() >= queries.size());
+    const size_t n = queries.size(), d = prefetch_distance;
+    for (size_t q = 0; q < n + 2 * d; ++q) {
+      if (q < n) __builtin_prefetch(rank.data() + queries[q].pos);
+      if (q >= d && q - d < n) {
+        const size_t r = rank[queries[q - d].pos];
+        __builtin_prefetch(lcp.level(0).data() + r);
+        __builtin_prefetch(full.level(0).data() + r);
+      }
+      if (q >= 2 * d && q - 2 * d < n) {
+        const auto& qu = queries[q - 2 * d];
+        dest[q - 2 * d] = encode::lz::find(qu.pos, rank[qu.pos], qu.max_dist, qu.min_len, lcp, full);
+      }
+    }
+  }
+
+  Tree<range_min<index_type>> lcp;
+  Tree<range_max<offset_type>> full;
+};
+
+template <typename T>
+using wide_8 = wide_segment_tree<T, 8>;
+
+template <typename T>
+using wide_16 = wide_segment_tree<T, 16>;
+
+void benchmark(const std::string& path, size_t repeat) {
+  std::vector<std::pair<std::string, std::vector<uint8_t>>> inputs;
+  {
+    std::vector<std::string> paths;
+    for (const auto& p : std::filesystem::recursive_directory_iterator(path)) {
+      if (!p.is_directory()) paths.emplace_back(p.path().string());
+    }
+    std::sort(paths.begin(), paths.end());
+    for (const auto& p : paths) {
+      const auto input = io::load(p);
+      if (input.empty()) continue;
+      std::vector<uint8_t> data;
+      for (size_t r = 0; r < repeat; ++r) data.insert(data.end(), input.begin(), input.end());
+      inputs.emplace_back(std::filesystem::path(p).filename().string(), std::move(data));
+    }
+  }
+
+  puts("| Input | Size | Pass | binary (Mq/s) | 8-ary (Mq/s) | 16-ary (Mq/s) | Same |");
+  puts("| :--- | :--- | :--- | :--- | :--- | :--- | :--- |");
+  for (const auto& [name, data] : inputs) {
+    const auto sa = suffix_array<uint8_t, index_type>(data);
+    const auto [lcp, rank] = sa.lcp_rank();
+    std::vector<index_type> sa_vec(sa.size());
+    for (size_t i = 0; i < sa.size(); ++i) sa_vec[i] = sa[i];
+
+    const layout<segment_tree> binary(sa_vec, lcp);
+    const layout<wide_8> w8(sa_vec, lcp);
+    const layout<wide_16> w16(sa_vec, lcp);
+
+    const auto print = [&](const char* pass, const pass_result& b, const pass_result& x, const pass_result& y) {
+      printf("| %s | %zX | %s | %.2f | %.2f | %.2f | %s |\n", name.c_str(), data.size(), pass,
+             b.qps / 1e6, x.qps / 1e6, y.qps / 1e6, (b.hash == x.hash && b.hash == y.hash) ? "yes" : "NO");
+    };
+    print("add, d=1000h", binary.forward(rank, 0x1000), w8.forward(rank, 0x1000), w16.forward(rank, 0x1000));
+    print("add, d=10000h", binary.forward(rank, 0x10000), w8.forward(rank, 0x10000), w16.forward(rank, 0x10000));
+    print("static, d=1000h",
+          binary.static_tree(rank, 0x1000), w8.static_tree(rank, 0x1000), w16.static_tree(rank, 0x1000));
+  }
+
+  // The static pass of the default layout, one query at a time and as a prefetching batch.
+  puts("");
+  puts("| Input | Size | Pass | single (Mq/s) | batch (Mq/s) | Same |");
+  puts("| :--- | :--- | :--- | :--- | :--- | :--- |");
+  for (const auto& [name, data] : inputs) {
+    const auto sa = suffix_array<uint8_t, index_type>(data);
+    const auto [lcp, rank] = sa.lcp_rank();
+    std::vector<index_type> sa_vec(sa.size());
+    for (size_t i = 0; i < sa.size(); ++i) sa_vec[i] = sa[i];
+
+    const layout<wide_8> w8(sa_vec, lcp);
+    for (const size_t max_dist : {0x1000, 0x10000}) {
+      std::vector<query> queries(data.size());
+      for (size_t i = 0; i < data.size(); ++i) queries[i] = {i, max_dist, 3};
+      const auto single = w8.static_tree(rank, max_dist);
+      const auto batch = w8.batch(rank, queries);
+      printf("| %s | %zX | static, d=%zXh | %.2f | %.2f | %s |\n", name.c_str(), data.size(), max_dist,
+             single.qps / 1e6, batch.qps / 1e6, single.hash == batch.hash ? "yes" : "NO");
+    }
+  }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    printf("Usage: %s <input-dir> [repeat]\n", argv[0]);
+    return 1;
+  }
+  benchmark(argv[1], (argc >= 3) ? std::stoul(argv[2]) : 1);
+  return 0;
+}
@@ -17,7 +17,7 @@ std::vector<uint8_t> addams_family_comp(std::span<const uint8_t> input) {
     {0x00a, 12, 0b1000'00000000 + 1}
   }, 0x108);
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 2, lens.back().max);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(9 + 0xff);
 
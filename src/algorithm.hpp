@@ -3,8 +3,11 @@
 #include <cstddef>
 #include <cassert>
 
+#include <functional>
+#include <utility>
 #include <vector>
 #include <limits>
+#include <stdexcept>
 
 #include <span>
 
@@ -64,6 +67,12 @@ struct linear {
 template <size_t C>
 struct constant : linear<0, C> {};
 
+template <size_t A, size_t B, size_t D>
+constexpr linear<A, B, D> as_linear(const linear<A, B, D>&) { return {}; }
+
+template <typename Cost>
+concept linear_cost = requires (const Cost& f) { as_linear(f); };
+
 template <size_t Numer, size_t Denom = 1,
   typename Compare = std::greater<size_t>, typename CostType = size_t>
 requires (Denom > 0)
@@ -123,12 +132,126 @@ class cost_window {
   std::array<segment_tree<range_min<value, iden>>, Denom> segs;
 };
 
-template <typename TagType, typename CostType = size_t>
-requires add_able<CostType, size_t>
-class solver {
+// A `cost_window<Numer, 1>` for the common access pattern of a backward DP: the positions are
+// updated in decreasing order, and each range query of `i` starts at `i + min_len` for a fixed
+// `min_len` (queries of a single position may start anywhere in the window).
+// The positions that are not beaten by an earlier one form a monotone list, and every position is
+// linked to the entry of that list that covers it, so that updates and queries take amortized O(1).
+template <size_t Numer, typename Compare = std::greater<size_t>, typename CostType = size_t>
+class monotone_cost_window {
+ public:
+  using cost_type = CostType;
+  static constexpr cost_type infinite_cost = cost_traits<cost_type>::infinity();
+  static constexpr size_t nlen = std::numeric_limits<size_t>::max();
+
+  struct len_cost {
+    size_t len;
+    cost_type cost;
+  };
+
+ private:
+  struct value {
+    constexpr auto operator < (const value& rhs) const {
+      return cost < rhs.cost || (cost == rhs.cost && Compare()(index, rhs.index));
+    }
+    cost_type cost;
+    size_t index;
+  };
+  static constexpr value iden = value(infinite_cost, nlen);
+
+ public:
+  monotone_cost_window() = default;
+  monotone_cost_window(size_t size, size_t min_len, size_t window_size, size_t beg = -2)
+      : n(size), min_len(min_len), mask(std::bit_ceil(std::min(n + 1, window_size + 1)) - 1),
+        lowest(n + 1), front(n + 1), head(nlen), vals(mask + 1, iden), next(mask + 1), link(mask + 1) {
+    assert(min_len > 0);
+    if (beg == size_t(-2)) beg = n;
+    if (beg <= n) update(beg, 0);
+  }
+
+  void update(size_t i, cost_type cost) {
+    assert(i < lowest);
+    for (size_t p = std::min(lowest, i + mask + 1); --p > i; ) vals[p & mask] = iden;
+    vals[i & mask] = {cost + i * Numer, i};
+    lowest = i;
+    while (front > i + min_len - 1) push(--front);
+  }
+
+  constexpr cost_type operator [](size_t i) const {
+    return vals[i & mask].cost + i * Numer;
+  }
+
+  len_cost find(size_t i, size_t fr, size_t to) const {
+    if ((fr += i) > n) return {nlen, infinite_cost};
+    to = std::min(n, i + to);
+    assert(fr <= to && to <= lowest + mask);
+    size_t k = to;
+    if (fr < to) {
+      assert(fr == front);
+      for (size_t p; (p = link[k & mask]) != k; ) k = link[k & mask] = link[p & mask];
+    }
+    const auto& res = vals[k & mask];
+    if (res.cost >= infinite_cost) return {nlen, infinite_cost};
+    return {res.index - i, res.cost - i * Numer};
+  }
+
+ private:
+  void push(size_t x) {
+    const auto& v = vals[x & mask];
+    size_t e = head;
+    for (; e <= x + mask && !(vals[e & mask] < v); e = next[e & mask]) link[e & mask] = x;
+    next[x & mask] = e; link[x & mask] = x; head = x;
+  }
+
+ private:
+  size_t n;
+  size_t min_len;
+  size_t mask;
+  size_t lowest;
+  size_t front;
+  size_t head;
+  std::vector<value> vals;
+  std::vector<size_t> next;
+  mutable std::vector<size_t> link; // compressed by `find`.
+};
+
+namespace detail {
+
+// Returns the smallest (or the largest if `Last`) l in [fr, to] that minimizes costs[l] + f(l),
+// along with the minimum.
+// `costs` must be contiguous, so `update_b` only uses it for `solver`. The layers of
+// `layered_solver` interleave their costs and take the plain loop of `update_b`.
+template <bool Last, size_t A, size_t B, size_t D>
+std::pair<size_t, size_t> argmin_linear(const size_t* costs, size_t fr, size_t to, linear<A, B, D> f) {
+  size_t best_l = fr, best = costs[fr] + f(fr);
+  for (size_t l = fr + 1; l <= to; ++l) {
+    const size_t c = costs[l] + f(l);
+    const bool better = Last ? (c <= best) : (c < best);
+    best_l = better ? l : best_l;
+    best = better ? c : best;
+  }
+  return {best_l, best};
+}
+
+template <typename CostType>
+struct cost_view {
+  CostType operator [] (size_t i) const { return p[i * stride]; }
+  size_t size() const { return n; }
+  const CostType* p;
+  size_t n;
+  size_t stride;
+};
+
+// The update rules of `solver` and of the layers of `layered_solver`.
+// `Derived` stores the nodes and provides `cost_at`, `len_at`, `node_at`, `costs` and `assign`.
+template <typename Derived, typename TagType, typename CostType, typename LenType>
+requires add_able<CostType, size_t> && std::unsigned_integral<LenType>
+class solver_base {
  public:
   using cost_type = CostType;
   using tag_type = TagType;
+  using len_type = LenType;
+  using arg_type = int32_t;
   static constexpr cost_type infinite_cost = cost_traits<cost_type>::infinity();
 
  public:
@@ -150,39 +273,62 @@ class solver {
      using cost_window<Numer, Denom, Less, C>::update;
    public:
     cmin() : cost_window<Numer, Denom, Less, C>() {}
-    cmin(std::span<const node> nd, size_t max_len, size_t dest = -2)
-      : cost_window<Numer, Denom, Less, C>(nd.size() - 1, max_len, -1), nd(nd) {
-      if (dest == size_t(-2)) dest = nd.size() - 1;
-      if (dest < nd.size()) update(dest);
+    cmin(cost_view<cost_type> costs, size_t max_len, size_t dest = -2)
+      : cost_window<Numer, Denom, Less, C>(costs.size() - 1, max_len, -1), costs(costs) {
+      if (dest == size_t(-2)) dest = costs.size() - 1;
+      if (dest < costs.size()) update(dest);
+    }
+    void update(size_t i) { update(i, costs[i]); }
+   private:
+    cost_view<cost_type> costs;
+  };
+
+  template <size_t Numer, typename Less = std::greater<size_t>, typename C = cost_type>
+  requires std::convertible_to<C, cost_type>
+  struct cmono : public monotone_cost_window<Numer, Less, C> {
+   protected:
+     using monotone_cost_window<Numer, Less, C>::update;
+   public:
+    cmono() : monotone_cost_window<Numer, Less, C>() {}
+    cmono(cost_view<cost_type> costs, size_t min_len, size_t max_len, size_t dest = -2)
+      : monotone_cost_window<Numer, Less, C>(costs.size() - 1, min_len, max_len, -1), costs(costs) {
+      if (dest == size_t(-2)) dest = costs.size() - 1;
+      if (dest < costs.size()) update(dest);
     }
-    void update(size_t i) { update(i, nd[i].cost); }
+    void update(size_t i) { update(i, costs[i]); }
    private:
-    std::span<const node> nd;
+    cost_view<cost_type> costs;
   };
 
  public:
-  solver() = default;
-  solver(size_t n, size_t dest = -2) : n(n), nodes(n + 1, infinite_cost) {
-    if (dest == size_t(-2)) dest = n;
-    if (dest <= n) nodes[dest] = cost_type(0);
-  }
+  solver_base() = default;
+  solver_base(size_t n) : n(n) {}
 
   template <size_t Numer, size_t Denom = 1, typename Less = std::greater<size_t>, typename C = cost_type>
   cmin<Numer, Denom, Less, C> c(size_t max_len, size_t dest = -2) const {
-    return cmin<Numer, Denom, Less, C>(this->nodes, max_len, dest);
+    return cmin<Numer, Denom, Less, C>(self().costs(), max_len, dest);
+  }
+
+  // Same as `c<Numer>`, for windows whose range queries of `i` all start at `i + min_len`.
+  template <size_t Numer, typename Less = std::greater<size_t>, typename C = cost_type>
+  cmono<Numer, Less, C> c_mono(size_t min_len, size_t max_len, size_t dest = -2) const {
+    return cmono<Numer, Less, C>(self().costs(), min_len, max_len, dest);
   }
 
   template <typename Pred = std::less<cost_type>>
   void update_c(size_t adr, size_t l, cost_type cost, tag_type tag, size_t arg = 0) {
-    if (auto& v = nodes[adr]; Pred()(cost, v.cost)) {
-      v.cost = cost; v.len = l; v.arg = arg; v.type = tag;
+    if (Pred()(cost, self().cost_at(adr))) {
+      // The nodes store `l` as `len_type` and `arg` as `arg_type`, which must not truncate them.
+      if (l != len_type(l)) throw std::out_of_range("solver: len does not fit in len_type.");
+      if (ptrdiff_t(arg) != arg_type(arg)) throw std::out_of_range("solver: arg does not fit in arg_type.");
+      self().assign(adr, cost, l, arg, tag);
     }
   }
 
   template <typename Pred = std::less<cost_type>>
   void update(size_t adr, size_t l, size_t c, tag_type tag, size_t arg = 0) {
     if (adr + l > n) return;
-    update_c<Pred>(adr, l, nodes[adr + l].cost + c, tag, arg);
+    update_c<Pred>(adr, l, self().cost_at(adr + l) + c, tag, arg);
   }
 
   template <typename Pred = std::less<cost_type>, class RangeMin>
@@ -209,9 +355,22 @@ class solver {
   template <typename Pred = std::less<cost_type>, typename Cost>
   requires std::convertible_to<std::invoke_result_t<Cost, size_t>, size_t>
   void update_b(size_t adr, size_t fr, size_t to, Cost&& f, tag_type tag, size_t arg = 0) {
+    constexpr bool less = std::is_same_v<Pred, std::less<cost_type>>;
+    constexpr bool less_equal = std::is_same_v<Pred, std::less_equal<cost_type>>;
+    if constexpr (std::is_same_v<cost_type, size_t> && linear_cost<std::remove_cvref_t<Cost>> &&
+                  (less || less_equal)) {
+      // Same as the loop below: the first (or the last for less_equal) length of the minimum wins.
+      if (const auto costs = self().costs(); costs.stride == 1) {
+        to = std::min(to, n - adr);
+        if (fr > to) return;
+        const auto [l, cost] = detail::argmin_linear<less_equal>(costs.p + adr, fr, to, as_linear(f));
+        update_c<Pred>(adr, l, cost, tag, arg);
+        return;
+      }
+    }
     for (size_t l = fr; l <= to; ++l) {
       if (adr + l > n) break;
-      update_c<Pred>(adr, l, nodes[adr + l].cost + f(l), tag, arg);
+      update_c<Pred>(adr, l, self().cost_at(adr + l) + f(l), tag, arg);
     }
   }
 
@@ -304,21 +463,21 @@ class solver {
                                     std::forward<LzFunc>(find_lz), std::forward<decltype(f)>(f));
   }
 
-  const node& operator [] (size_t i) const { return nodes[i]; }
+  node operator [] (size_t i) const { return self().node_at(i); }
 
   struct path {
-    template <typename Node>
     struct iterator {
-      using iterator_category = std::forward_iterator_tag;
-      using reference = Node&;
-      using value_type = Node;
-      using pointer = Node*;
+      using iterator_category = std::input_iterator_tag;
+      using difference_type = ptrdiff_t;
+      using reference = node;
+      using value_type = node;
 
-      iterator(pointer p) : p(p) {}
-      reference operator* () { return *p; }
+      iterator(const Derived* s, size_t i) : s(s), i(i) {}
+      reference operator* () const { return s->node_at(i); }
       iterator& operator++ () {
-        if (p->len == 0) throw std::logic_error("cmd.len == 0.");
-        p += p->len;
+        const size_t len = s->len_at(i);
+        if (len == 0) throw std::logic_error("cmd.len == 0.");
+        i += len;
         return *this;
       }
       iterator operator++ (int) {
@@ -327,16 +486,16 @@ class solver {
         return ret;
       }
       friend bool operator == (const iterator& lhs, const iterator& rhs) {
-        return lhs.p == rhs.p;
+        return lhs.i == rhs.i;
       }
     private:
-      pointer p;
+      const Derived* s;
+      size_t i;
     };
-    using const_iterator = iterator<const node>;
+    using const_iterator = iterator;
 
-    path(std::span<const node> nodes, size_t begin, size_t end)
-        : b(&nodes[begin]), e(&nodes[end]) {
-      if (begin > nodes.size() || end > nodes.size()) throw std::logic_error("invalid path.");
+    path(const Derived& s, size_t begin, size_t end) : b(&s, begin), e(&s, end) {
+      if (begin > s.n + 1 || end > s.n + 1) throw std::logic_error("invalid path.");
     }
 
     size_t size() const {
@@ -353,16 +512,278 @@ class solver {
   };
 
   path optimal_path(size_t begin = 0) const {
-    return path(nodes, begin, n);
+    return path(self(), begin, n);
   }
 
   cost_type optimal_cost(size_t adr = 0) const {
-    return nodes[adr].cost;
+    return self().cost_at(adr);
   }
 
  private:
+  const Derived& self() const { return static_cast<const Derived&>(*this); }
+  Derived& self() { return static_cast<Derived&>(*this); }
+
+ protected:
   size_t n;
-  std::vector<node> nodes;
 };
 
+} // namespace detail
+
+// Stores the costs densely and the commands in separate narrow arrays: `arg` is kept as a 32-bit
+// signed value, and `LenType` may be set to `uint16_t` when every length of the format fits.
+template <typename TagType, typename CostType = size_t, typename LenType = uint32_t>
+class solver : public detail::solver_base<solver<TagType, CostType, LenType>, TagType, CostType, LenType> {
+  using base = detail::solver_base<solver, TagType, CostType, LenType>;
+  friend base;
+
+ public:
+  using typename base::cost_type;
+  using typename base::tag_type;
+  using typename base::len_type;
+  using typename base::arg_type;
+  using typename base::node;
+  using base::infinite_cost;
+
+ public:
+  solver() = default;
+  solver(size_t n, size_t dest = -2)
+      : base(n), costs_(n + 1, infinite_cost), lens(n + 1), args(n + 1), types(n + 1) {
+    if (dest == size_t(-2)) dest = n;
+    if (dest <= n) costs_[dest] = cost_type(0);
+  }
+
+  // Clears the nodes for another solve of the same size (e.g. with updated costs),
+  // reusing the storage.
+  void reset(size_t dest = -2) {
+    std::ranges::fill(costs_, infinite_cost);
+    std::ranges::fill(lens, len_type());
+    std::ranges::fill(args, arg_type());
+    std::ranges::fill(types, tag_type());
+    if (dest == size_t(-2)) dest = this->n;
+    if (dest <= this->n) costs_[dest] = cost_type(0);
+  }
+
+ private:
+  cost_type cost_at(size_t i) const { return costs_[i]; }
+  size_t len_at(size_t i) const { return lens[i]; }
+  node node_at(size_t i) const {
+    node ret(costs_[i]);
+    ret.len = lens[i]; ret.arg = ptrdiff_t(args[i]); ret.type = types[i];
+    return ret;
+  }
+  detail::cost_view<cost_type> costs() const { return {costs_.data(), costs_.size(), 1}; }
+  void assign(size_t i, cost_type cost, size_t len, size_t arg, tag_type tag) {
+    costs_[i] = cost; lens[i] = len; args[i] = arg; types[i] = tag;
+  }
+
+ private:
+  std::vector<cost_type> costs_;
+  std::vector<len_type> lens;
+  std::vector<arg_type> args;
+  std::vector<tag_type> types;
+};
+
+// A DP with several states (layers) per position, such as the phase of a flag byte or the current
+// width of a length field. The nodes of all layers of one position are stored next to each other.
+// `operator [](k)` returns layer `k`, which has the same interface as `solver`.
+template <typename TagType, typename CostType = size_t, typename LenType = uint32_t>
+class layered_solver {
+ public:
+  class layer : public detail::solver_base<layer, TagType, CostType, LenType> {
+    using base = detail::solver_base<layer, TagType, CostType, LenType>;
+    friend base;
+    friend layered_solver;
+
+   public:
+    using typename base::cost_type;
+    using typename base::tag_type;
+    using typename base::node;
+
+    layer(layered_solver& s, size_t k) : base(s.n), s(&s), k(k) {}
+
+   private:
+    size_t index(size_t i) const { return i * s->layers + k; }
+    cost_type cost_at(size_t i) const { return s->costs_[index(i)]; }
+    size_t len_at(size_t i) const { return s->lens[index(i)]; }
+    node node_at(size_t i) const { return s->node_at(index(i)); }
+    detail::cost_view<cost_type> costs() const { return {s->costs_.data() + k, s->n + 1, s->layers}; }
+    void assign(size_t i, cost_type cost, size_t len, size_t arg, tag_type tag) {
+      const size_t j = index(i);
+      s->costs_[j] = cost; s->lens[j] = len; s->args[j] = arg; s->types[j] = tag;
+    }
+
+   private:
+    layered_solver* s;
+    size_t k;
+  };
+
+  using cost_type = typename layer::cost_type;
+  using tag_type = typename layer::tag_type;
+  using len_type = typename layer::len_type;
+  using arg_type = typename layer::arg_type;
+  using node = typename layer::node;
+  static constexpr cost_type infinite_cost = layer::infinite_cost;
+  static constexpr size_t any_layer = -1;
+
+  struct layered_node : node {
+    layered_node(const node& nd, size_t layer) : node(nd), layer(layer) {}
+    size_t layer;
+  };
+
+ public:
+  layered_solver() = default;
+
+  // `dest(k)` is the goal of layer `k` (-1 if the layer has none).
+  template <typename DestFunc>
+  requires std::convertible_to<std::invoke_result_t<DestFunc, size_t>, size_t>
+  layered_solver(size_t n, size_t layers, DestFunc&& dest)
+      : n(n), layers(layers), costs_((n + 1) * layers, infinite_cost),
+        lens((n + 1) * layers), args((n + 1) * layers), types((n + 1) * layers) {
+    for (size_t k = 0; k < layers; ++k) {
+      if (const size_t d = dest(k); d <= n) costs_[d * layers + k] = cost_type(0);
+    }
+  }
+
+  layered_solver(size_t n, size_t layers, size_t dest = -2)
+      : layered_solver(n, layers, [&](size_t) { return dest == size_t(-2) ? n : dest; }) {}
+
+  // Clears the nodes for another solve of the same size, reusing the storage.
+  template <typename DestFunc>
+  requires std::convertible_to<std::invoke_result_t<DestFunc, size_t>, size_t>
+  void reset(DestFunc&& dest) {
+    std::ranges::fill(costs_, infinite_cost);
+    std::ranges::fill(lens, len_type());
+    std::ranges::fill(args, arg_type());
+    std::ranges::fill(types, tag_type());
+    for (size_t k = 0; k < layers; ++k) {
+      if (const size_t d = dest(k); d <= n) costs_[d * layers + k] = cost_type(0);
+    }
+  }
+
+  layer operator [] (size_t k) { return layer(*this, k); }
+
+  size_t size() const { return layers; }
+
+  template <typename NextFunc>
+  struct path {
+    struct iterator {
+      using iterator_category = std::input_iterator_tag;
+      using difference_type = ptrdiff_t;
+      using reference = layered_node;
+      using value_type = layered_node;
+
+      iterator(const path* p, size_t k, size_t i) : p(p), k(k), i(i) {}
+      reference operator* () const { return {p->s->node_at(i * p->s->layers + k), k}; }
+      iterator& operator++ () {
+        const auto cmd = p->s->node_at(i * p->s->layers + k);
+        const size_t nk = p->next(k, cmd);
+        if (cmd.len == 0 && nk == k) throw std::logic_error("cmd.len == 0.");
+        if (nk >= p->s->layers) throw std::logic_error("invalid layer.");
+        i += cmd.len; k = nk;
+        return *this;
+      }
+      iterator operator++ (int) {
+        iterator ret = *this;
+        ++(*this);
+        return ret;
+      }
+      friend bool operator == (const iterator& lhs, const iterator& rhs) {
+        return lhs.i == rhs.i && (lhs.k == rhs.k || lhs.k == any_layer || rhs.k == any_layer);
+      }
+    private:
+      const path* p;
+      size_t k;
+      size_t i;
+    };
+    using const_iterator = iterator;
+
+    path(const layered_solver& s, NextFunc next, size_t k, size_t begin, size_t end_layer)
+        : s(&s), next(std::move(next)), k(k), b(begin), end_layer(end_layer) {
+      if (begin > s.n || k >= s.layers) throw std::logic_error("invalid path.");
+    }
+
+    size_t size() const {
+      size_t ret = 0;
+      for (auto it = begin(); it != end(); ++it) ret += 1;
+      return ret;
+    }
+
+    const_iterator begin() const { return {this, k, b}; }
+    const_iterator end() const { return {this, end_layer, s->n}; }
+
+   private:
+    const layered_solver* s;
+    NextFunc next;
+    size_t k;
+    size_t b;
+    size_t end_layer;
+  };
+
+  // Follows the commands from layer `k` at `begin` until position `n` is reached in `end_layer`.
+  // `next(k, cmd)` returns the layer that `cmd` of layer `k` moves to; commands of length 0 must
+  // change the layer.
+  template <typename NextFunc>
+  requires std::convertible_to<std::invoke_result_t<NextFunc, size_t, const node&>, size_t>
+  path<std::decay_t<NextFunc>> optimal_path(size_t k, NextFunc&& next,
+      size_t end_layer = any_layer, size_t begin = 0) const {
+    return path<std::decay_t<NextFunc>>(*this, std::forward<NextFunc>(next), k, begin, end_layer);
+  }
+
+ private:
+  node node_at(size_t j) const {
+    node ret(costs_[j]);
+    ret.len = lens[j]; ret.arg = ptrdiff_t(args[j]); ret.type = types[j];
+    return ret;
+  }
+
+ private:
+  size_t n;
+  size_t layers;
+  std::vector<cost_type> costs_;
+  std::vector<len_type> lens;
+  std::vector<arg_type> args;
+  std::vector<tag_type> types;
+};
+
+// A cheaper replacement of the optimal parse for formats that consist of literals and lz commands
+// whose costs do not depend on the offset and the length: at each position it takes the match
+// of a `hash_chain_lz_helper` (level::greedy), or a literal if the next position has a longer
+// match (level::lazy). Returns the commands of [begin, input.size()) in the form of
+// `solver::optimal_path`, so that the same writer can be used. `cost` of the nodes is not set.
+template <typename TagType>
+std::vector<typename solver<TagType>::node> greedy_path(
+    std::span<const uint8_t> input, size_t begin, const size_t lz_max_ofs,
+    const size_t lz_min_len, const size_t lz_max_len,
+    const TagType uncomp, const TagType lz, const bool lazy) {
+  using node_type = typename solver<TagType>::node;
+  std::vector<node_type> ret;
+  const auto push = [&](size_t len, size_t arg, TagType type) {
+    node_type& cmd = ret.emplace_back(0);
+    cmd.len = len; cmd.arg = arg; cmd.type = type;
+  };
+
+  hash_chain_lz_helper lz_helper(input, std::min<size_t>(lz_min_len, 3), lazy ? 32 : 8);
+  const auto find = [&](size_t i) -> encode::lz_data {
+    return (i < input.size()) ? lz_helper.find(i, lz_max_ofs, lz_min_len, lz_max_len) : encode::lz_data{0, 0};
+  };
+  for (size_t i = 0; i < begin; ++i) lz_helper.add_element(i);
+
+  auto res_lz = find(begin);
+  for (size_t i = begin; i < input.size(); ) {
+    lz_helper.add_element(i);
+    const auto next_lz = (lazy && res_lz.len > 0) ? find(i + 1) : encode::lz_data{0, 0};
+    if (res_lz.len == 0 || next_lz.len > res_lz.len) {
+      push(1, 0, uncomp);
+      res_lz = (lazy && res_lz.len > 0) ? next_lz : find(i + 1);
+      i += 1;
+    } else {
+      push(res_lz.len, res_lz.ofs, lz);
+      for (size_t j = i + 1; j < i + res_lz.len; ++j) lz_helper.add_element(j);
+      i += res_lz.len;
+      res_lz = find(i);
+    }
+  }
+  return ret;
+}
+
 } // namespace sfc_comp
@@ -52,12 +52,12 @@ std::vector<uint8_t> asameshimae_nyanko_comp(std::span<const uint8_t> input) {
   }
 
   const auto lz_memo = [&] {
-    std::vector<std::array<encode::lz_data, ofs_tab.size()>> ret(input.size());
-    lz_helper lz_helper(input);
+    lz_memo_table ret(ofs_tab.size()); ret.reserve(input.size());
+    std::array<encode::lz_data, ofs_tab.size()> res_lz;
+    level_lz_helper lz_helper(input, false, lz_min_len, lz_max_len);
     for (size_t i = 0; i < input.size(); ++i) {
-      encode::lz::find_all(i, ofs_tab, lz_min_len, ret[i], [&](size_t max_ofs) {
-        return lz_helper.find_closest(i, max_ofs, lz_min_len, lz_max_len);
-      });
+      lz_helper.find_all_closest(i, ofs_tab, lz_min_len, lz_max_len, res_lz);
+      ret.push_back(res_lz);
       lz_helper.add_element(i);
     }
     return ret;
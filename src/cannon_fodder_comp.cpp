@@ -1,3 +1,5 @@
+#include <tuple>
+
 #include "algorithm.hpp"
 #include "encode.hpp"
 #include "utility.hpp"
@@ -56,11 +58,9 @@ std::vector<uint8_t> cannon_fodder_comp(std::span<const uint8_t> input) {
   const auto [lz_memo, longest_lz_len] = [&] {
     size_t longest_lz_len = lz_min_len;
     std::vector<std::array<encode::lz_data, max_offsets.size()>> ret(input.size());
-    lz_helper lz_helper(input);
+    level_lz_helper lz_helper(input, false, lz_min_len, input.size());
     for (size_t i = 0; i < input.size(); ++i) {
-      encode::lz::find_all(i, max_offsets, lz_min_len, ret[i], [&](size_t max_ofs) {
-        return lz_helper.find_closest(i, max_ofs, lz_min_len, input.size());
-      });
+      lz_helper.find_all_closest(i, max_offsets, lz_min_len, input.size(), ret[i]);
       if (const auto lz = ret[i].back(); lz.len >= lz_min_len) {
         longest_lz_len = std::max(longest_lz_len, lz.len);
       }
@@ -78,13 +78,13 @@ std::vector<uint8_t> cannon_fodder_comp(std::span<const uint8_t> input) {
   }();
   const size_t oi_limit = std::min(max_oi, std::bit_width(input.size()));
 
-  using solver_type = solver<tag>;
-  std::array<std::array<solver_type, max_oi + 1>, max_li + 1> dp;
+  const size_t oi_count = oi_limit - min_oi + 1;
+  layered_solver<tag> dp_layers(input.size(), (li_limit - min_li + 1) * oi_count);
+  const auto dp = [&](size_t li, size_t oi) { return dp_layers[(li - min_li) * oi_count + (oi - min_oi)]; };
   std::array<std::array<std::array<cost_window<0>, 2>, max_oi + 1>, max_li + 1> c0;
 
   for (size_t li = min_li; li <= li_limit; ++li) {
     for (size_t oi = min_oi; oi <= oi_limit; ++oi) {
-      dp[li][oi] = solver_type(input.size());
       const auto [bit, size] = split(oi, input.size());
       c0[li][oi][bit] = cost_window<0>(size, len_vals[li].back() - 1);
       c0[li][oi][1 - bit] = cost_window<0>(input.size() - size, len_vals[li].back() - 1, -1);
@@ -97,9 +97,10 @@ std::vector<uint8_t> cannon_fodder_comp(std::span<const uint8_t> input) {
       for (size_t oi = min_oi; oi <= oi_limit; ++oi) {
         const bool reachable = (oi == max_oi) || !((i >> oi) & 1) || (oi > min_oi && ((i >> (oi - 1)) & 1));
         const auto [b, adr] = split(oi, i);
+        auto dpl = dp(li, oi);
         if (reachable) {
           const auto [nb, nadr] = split(oi, i + 1);
-          dp[li][oi].update_c(i, 1, c0[li][oi][nb][nadr] + 9, {uncomp, std::min(oi + nb, max_oi), li});
+          dpl.update_c(i, 1, c0[li][oi][nb][nadr] + 9, {uncomp, std::min(oi + nb, max_oi), li});
           const auto res_lz = lz_memo[i][oi];
           if (res_lz.len >= lz_min_len) {
             const auto [len0, len1] = uppers(oi, i + res_lz.len);
@@ -110,23 +111,23 @@ std::vector<uint8_t> cannon_fodder_comp(std::span<const uint8_t> input) {
               if (~to0 && fr0 <= len0) {
                 const auto e = c0[nli][oi][0].find(0, fr0, std::min(len0, to0));
                 const auto l = merge(oi, 0, e.len) - i;
-                dp[li][oi].update_c(i, l, e.cost + oi + li + 1, {lz, oi, nli}, res_lz.ofs);
+                dpl.update_c(i, l, e.cost + oi + li + 1, {lz, oi, nli}, res_lz.ofs);
               }
               if (~to1 && ~len1 && fr1 <= len1) {
                 const size_t noi = std::min(oi + 1, max_oi); assert(noi <= oi_limit);
                 const auto e = c0[nli][oi][1].find(0, fr1, std::min(len1, to1));
                 const auto l = merge(oi, 1, e.len) - i;
-                dp[li][oi].update_c(i, l, e.cost + oi + li + 1, {lz, noi, nli}, res_lz.ofs);
+                dpl.update_c(i, l, e.cost + oi + li + 1, {lz, noi, nli}, res_lz.ofs);
               }
             }
           }
-          c0[li][oi][b].update(adr, dp[li][oi][i].cost);
+          c0[li][oi][b].update(adr, dpl[i].cost);
           if (oi > min_oi && ((i >> (oi - 1)) & 1)) {
             const auto [lb, ladr] = split(oi - 1, i);
-            c0[li][oi - 1][lb].update(ladr, dp[li][oi][i].cost);
+            c0[li][oi - 1][lb].update(ladr, dpl[i].cost);
           }
         } else {
-          c0[li][oi][b].update(adr, solver<tag>::infinite_cost);
+          c0[li][oi][b].update(adr, dp_layers.infinite_cost);
         }
       }
     }
@@ -135,8 +136,11 @@ std::vector<uint8_t> cannon_fodder_comp(std::span<const uint8_t> input) {
   using namespace data_type;
   writer_b8_h ret(4);
   size_t adr = 0;
-  for (size_t li = min_li, oi = min_oi; adr < input.size(); ) {
-    const auto& cmd = dp[li][oi][adr];
+  const auto next_layer = [&](size_t, const auto& cmd) -> size_t {
+    return (cmd.type.li - min_li) * oi_count + (cmd.type.oi - min_oi);
+  };
+  for (const auto& cmd : dp_layers.optimal_path(0, next_layer)) {
+    size_t li = cmd.layer / oi_count + min_li, oi = cmd.layer % oi_count + min_oi;
     const auto [tag, noi, nli] = cmd.type;
     assert(cmd.len > 0);
     switch (cmd.type.tag) {
@@ -160,7 +164,7 @@ std::vector<uint8_t> cannon_fodder_comp(std::span<const uint8_t> input) {
   }
   write32b(ret.out, 0, input.size());
   assert(adr == input.size());
-  assert(dp[min_li][min_oi].optimal_cost() + 8 * 4 == ret.bit_length());
+  assert(dp(min_li, min_oi).optimal_cost() + 8 * 4 == ret.bit_length());
   return ret.out;
 }
 
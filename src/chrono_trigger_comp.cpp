@@ -1,5 +1,6 @@
 #include "algorithm.hpp"
 #include "encode.hpp"
+#include "options.hpp"
 #include "utility.hpp"
 #include "writer.hpp"
 
@@ -12,38 +13,52 @@ std::vector<uint8_t> chrono_trigger_comp_fast_core(std::span<const uint8_t> inpu
 
   enum tag { uncomp, lz };
 
-  std::vector<uint8_t> best;
-
-  for (size_t len_bits = 4; len_bits <= max_len_bits; ++len_bits) {
+  const size_t lv = level::use();
+  const auto index = (lv < level::optimal) ? nullptr : match_index<>::create(input);
+  return parallel::best_of(max_len_bits - 3, input.size(), [&](size_t k) {
+    const size_t len_bits = k + 4;
     const size_t lz_min_len = 3;
     const size_t lz_max_len = ((1 << len_bits) - 1) + lz_min_len;
     const size_t lz_max_ofs = (0x10000 >> len_bits) - 1;
 
-    lz_helper lz_helper(input, true);
-    solver<tag> dp(input.size());
-    auto c0 = dp.c<0>(lz_max_len);
-
-    for (size_t i = input.size(); i-- > 0; ) {
-      lz_helper.reset(i);
-      dp.update(i, 1, 9, uncomp);
-      dp.update(i, lz_min_len, lz_max_len,
-                lz_helper.find(i, lz_max_ofs, lz_min_len), c0, 17, lz);
-      c0.update(i);
-    }
-
     using namespace data_type;
     writer_b8_l ret(2);
-    size_t adr = 0;
-    for (const auto& cmd : dp.optimal_path()) {
-      switch (cmd.type) {
-      case uncomp: ret.write<b1, d8>(false, input[adr]); break;
-      case lz: ret.write<b1, d16>(true, (adr - cmd.lz_ofs()) | (cmd.len - lz_min_len) << (16 - len_bits)); break;
-      default: assert(0);
+    const auto write = [&](const auto& path, [[maybe_unused]] size_t cost) {
+      // The flags end in a partial byte iff the cost does, in which case a 3-byte gap is opened below.
+      ret.reserve((cost + 2 * 8 + 7) / 8 + (cost % 8 != 0 ? 3 : 0) + 1);
+      size_t adr = 0;
+      for (const auto& cmd : path) {
+        switch (cmd.type) {
+        case uncomp: ret.write<b1, d8>(false, input[adr]); break;
+        case lz: ret.write<b1, d16>(true, (adr - cmd.lz_ofs()) | (cmd.len - lz_min_len) << (16 - len_bits)); break;
+        default: assert(0);
+        }
+        adr += cmd.len;
       }
-      adr += cmd.len;
+      assert(adr == input.size());
+      assert(cost + 2 * 8 == ret.bit_length());
+    };
+
+    if (lv < level::optimal) {
+      const auto path = greedy_path<tag>(input, 0, lz_max_ofs, lz_min_len, lz_max_len,
+                                         uncomp, lz, lv == level::lazy);
+      size_t cost = 0;
+      for (const auto& cmd : path) cost += (cmd.type == uncomp) ? 9 : 17;
+      write(path, cost);
+    } else {
+      lz_helper lz_helper(index, true);
+      solver<tag> dp(input.size());
+      auto c0 = dp.c_mono<0>(lz_min_len, lz_max_len);
+
+      for (size_t i = input.size(); i-- > 0; ) {
+        lz_helper.reset(i);
+        dp.update(i, 1, 9, uncomp);
+        dp.update(i, lz_min_len, lz_max_len,
+                  lz_helper.find(i, lz_max_ofs, lz_min_len), c0, 17, lz);
+        c0.update(i);
+      }
+      write(dp.optimal_path(), dp.optimal_cost());
     }
-    assert(adr == input.size());
-    assert(dp.optimal_cost() + 2 * 8 == ret.bit_length());
 
     const size_t method_bit = (len_bits == 4) ? 0x00 : 0x40;
     if (ret.bit == 0) {
@@ -52,19 +67,16 @@ std::vector<uint8_t> chrono_trigger_comp_fast_core(std::span<const uint8_t> inpu
       const size_t bits_pos = ret.bits_pos;
       write16(ret.out, 0, bits_pos - 2);
 
-      const size_t len = (8 - ret.bit) + std::popcount(ret.out[bits_pos]) + 1;
+      [[maybe_unused]] const size_t len = (8 - ret.bit) + std::popcount(ret.out[bits_pos]) + 1;
       assert(ret.size() == bits_pos + len);
-      ret.write<d8, d8, d8>(0, 0, 0);
-
-      for (size_t i = 0; i < len; ++i) ret[ret.size() - 1 - i] = ret[ret.size() - 4 - i];
+      ret.insert(bits_pos, 3);
       ret[bits_pos] = (8 - ret.bit) | method_bit;
       write16(ret.out, bits_pos + 1, ret.size());
       ret[bits_pos + 3] |= low_bits_mask(ret.bit) << (8 - ret.bit); // Avoids 0x00. (cf. $C3:07B7, $C3:0879, etc. in Chrono Trigger)
     }
     ret.write<d8>(method_bit);
-    if (best.empty() || ret.size() < best.size()) best = std::move(ret.out);
-  }
-  return best;
+    return std::move(ret.out);
+  });
 }
 
 std::vector<uint8_t> chrono_trigger_comp_core(
@@ -74,20 +86,20 @@ std::vector<uint8_t> chrono_trigger_comp_core(
   enum method { uncomp, lz };
   using tag = tag_ol<method>;
 
-  std::vector<uint8_t> best;
-
-  for (size_t len_bits = 4; len_bits <= max_len_bits; ++len_bits) {
+  const auto index = level_lz_helper<>::analyze(input);
+  return parallel::best_of(max_len_bits - 3, input.size(),
+      [&](size_t k, const parallel::candidate& cand) -> std::optional<std::vector<uint8_t>> {
+    const size_t len_bits = k + 4;
     const size_t lz_min_len = 3;
     const size_t lz_max_len = ((1 << len_bits) - 1) + lz_min_len;
     const size_t lz_max_ofs = (0x10000 >> len_bits) - 1;
 
-    lz_helper lz_helper(input, true);
-    std::array<solver<tag>, 8> dp;
-    for (size_t b = 0; b < 8; ++b) {
-      dp[b] = solver<tag>(input.size(), (b == 0) ? input.size() : -1);
-    }
-    auto c0s = create_array<decltype(dp[0].c<0>(0)), 8>([&](size_t b) {
-      return dp[b].c<0>(lz_max_len);
+    level_lz_helper lz_helper(input, index, true, lz_min_len, lz_max_len);
+    layered_solver<tag> dp(input.size(), 8, [&](size_t b) {
+      return (b == 0) ? input.size() : size_t(-1);
+    });
+    auto c0s = create_array<decltype(dp[0].c_mono<0>(0, 0)), 8>([&](size_t b) {
+      return dp[b].c_mono<0>(lz_min_len, lz_max_len);
     });
     auto c1 = dp[0].c<1>(lz_max_len + max_bits);
 
@@ -114,15 +126,17 @@ std::vector<uint8_t> chrono_trigger_comp_core(
       for (size_t b = 0; b < 8; ++b) c0s[b].update(i);
       c1.update(i);
     }
+    if (cand.beaten(dp[0].optimal_cost() + 3)) return std::nullopt;
 
     const size_t method_bit = (len_bits == 4) ? 0x00 : 0x40;
     if (method_bit > 0) assert(max_bits < method_bit);
 
     using namespace data_type;
-    writer_b8_l ret(2);
+    writer_b8_l ret(2); ret.reserve(dp[0].optimal_cost() + 3);
     size_t adr = 0; size_t ofs_pos = 0;
-    for (size_t curr = 0; adr < input.size(); ) {
-      const auto& cmd = dp[curr][adr];
+    const auto next_layer = [](size_t, const auto& cmd) -> size_t { return cmd.type.oi; };
+    for (const auto& cmd : dp.optimal_path(0, next_layer)) {
+      const size_t curr = cmd.layer;
       const auto [tag, next, ulen] = cmd.type;
       switch (tag) {
       case uncomp: {
@@ -140,14 +154,12 @@ std::vector<uint8_t> chrono_trigger_comp_core(
         assert(ofs_pos + 2 <= ret.size());
         write16(ret.out, ofs_pos, bits_pos);
         ret.write<bnh>({ret.bit, ulen == 0 ? low_bits_mask(ret.bit) : 0});
-        ret.write<d24>(0);
-        for (size_t i = ret.size() - 1; i - 3 >= bits_pos; --i) ret[i] = ret[i - 3];
+        ret.insert(bits_pos, 3);
         if (ulen > 0) ret.write<d8n>({ulen, &input[adr + (cmd.len - ulen)]});
         ret[bits_pos + 0] = (bits + ulen) | method_bit;
         ofs_pos = bits_pos + 1;
       }
       adr += cmd.len;
-      curr = next;
     }
     write16(ret.out, ofs_pos, ret.size());
     write16(ret.out, 0, read16(ret.out, 0) - 2);
@@ -155,9 +167,8 @@ std::vector<uint8_t> chrono_trigger_comp_core(
     assert(adr == input.size());
     assert(dp[0].optimal_cost() + 3 == ret.size());
 
-    if (best.empty() || ret.size() < best.size()) best = std::move(ret.out);
-  }
-  return best;
+    return std::move(ret.out);
+  });
 }
 
 
@@ -10,7 +10,7 @@ std::vector<uint8_t> danzarb_comp(std::span<const uint8_t> input) {
 
   enum tag { uncomp, lz };
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 1, 32);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(32);
   auto c8 = dp.c<8>(8);
@@ -1,12 +1,177 @@
 #pragma once
 
+#include <cstdint>
+
 #include <algorithm>
+#include <array>
+#include <type_traits>
 #include <vector>
 
 #include <bit>
+#include <numeric>
+#include <span>
+
+#include "parallel.hpp"
 
 namespace sfc_comp {
 
+namespace detail {
+
+// Stores `value(i)` for every i in [0, n) with `pred(i)` into `dest`, in increasing order of i.
+// With multiple workers, each block counts its elements first and then writes them at its offset.
+template <typename IndexType, typename Pred, typename Value>
+void collect(size_t n, size_t workers, std::vector<IndexType>& dest, Pred&& pred, Value&& value) {
+  dest.clear();
+  if (parallel::blocks(n, workers) == 1) {
+    for (size_t i = 0; i < n; ++i) {
+      if (pred(i)) dest.push_back(value(i));
+    }
+    return;
+  }
+  std::vector<size_t> offsets(parallel::blocks(n, workers) + 1, 0);
+  parallel::for_each_block(n, workers, [&](size_t t, size_t beg, size_t end) {
+    size_t count = 0;
+    for (size_t i = beg; i < end; ++i) count += pred(i) ? 1 : 0;
+    offsets[t + 1] = count;
+  });
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  dest.resize(offsets.back());
+  parallel::for_each_block(n, workers, [&](size_t t, size_t beg, size_t end) {
+    for (size_t i = beg, o = offsets[t]; i < end; ++i) {
+      if (pred(i)) dest[o++] = value(i);
+    }
+  });
+}
+
+// SA-IS (Nong, Zhang and Chan). The symbols of `s` must be in [0, upper].
+// Suffixes are ordered lexicographically and a proper prefix precedes the longer suffix.
+// With multiple workers, the suffixes are classified, the buckets counted and the LMS suffixes
+// collected and named block by block. The induced sorting scans themselves are sequential.
+template <typename IndexType, typename CharType>
+requires std::unsigned_integral<IndexType> && std::unsigned_integral<CharType>
+void sa_is(std::span<const CharType> s, const size_t upper, std::span<IndexType> sa, size_t workers = 1) {
+  using index_type = IndexType;
+  static constexpr index_type nval = index_type(-1);
+
+  const size_t n = s.size();
+  if (n <= 16) {
+    for (size_t i = 0; i < n; ++i) sa[i] = i;
+    std::sort(sa.begin(), sa.end(), [&](const index_type a, const index_type b) {
+      return std::lexicographical_compare(s.begin() + a, s.end(), s.begin() + b, s.end());
+    });
+    return;
+  }
+
+  // ls[i]: whether the suffix i is S-type, i.e. s[i] is less than the first symbol after it that differs.
+  // Each block classifies its positions up to its trailing run, whose type depends on the blocks after
+  // it. The trailing runs are then resolved from back to front and filled in.
+  std::vector<uint8_t> ls(n, false);
+  const size_t type_blocks = parallel::blocks(n, workers);
+  std::vector<size_t> run_begin(type_blocks), block_end(type_blocks);
+  std::vector<uint8_t> run_type(type_blocks);
+  parallel::for_each_block(n, type_blocks, [&](size_t t, size_t beg, size_t end) {
+    size_t r = end - 1;
+    while (r > beg && s[r - 1] == s[end - 1]) --r;
+    run_begin[t] = r; block_end[t] = end;
+    for (size_t i = r; i-- > beg; ) {
+      ls[i] = (s[i] == s[i + 1]) ? ls[i + 1] : (s[i] < s[i + 1]);
+    }
+  });
+  for (size_t t = type_blocks; t-- > 0; ) {
+    const size_t e = block_end[t];
+    if (e == n) run_type[t] = false;
+    else if (s[e] != s[e - 1]) run_type[t] = s[e - 1] < s[e];
+    else run_type[t] = (e < run_begin[t + 1]) ? ls[e] : run_type[t + 1];
+  }
+  parallel::for_each_block(n, type_blocks, [&](size_t t, size_t, size_t end) {
+    std::fill(ls.begin() + run_begin[t], ls.begin() + end, run_type[t]);
+  });
+
+  // Each block counts the (symbol, type) pairs of its range, as long as the counts are small next to it.
+  const size_t count_blocks = parallel::blocks(n, std::min(workers, n / (8 * (upper + 1))));
+  std::vector<index_type> counts(count_blocks * 2 * (upper + 1), 0);
+  parallel::for_each_block(n, count_blocks, [&](size_t t, size_t beg, size_t end) {
+    index_type* const cnt = counts.data() + t * 2 * (upper + 1);
+    for (size_t i = beg; i < end; ++i) cnt[2 * s[i] + ls[i]] += 1;
+  });
+  std::vector<index_type> sum_l(upper + 1, 0), sum_s(upper + 1, 0);
+  for (size_t t = 0; t < count_blocks; ++t) {
+    const index_type* const cnt = counts.data() + t * 2 * (upper + 1);
+    for (size_t c = 0; c <= upper; ++c) {
+      sum_s[c] += cnt[2 * c];
+      if (c < upper) sum_l[c + 1] += cnt[2 * c + 1];
+    }
+  }
+  counts = std::vector<index_type>();
+  for (size_t c = 0; c <= upper; ++c) {
+    sum_s[c] += sum_l[c];
+    if (c < upper) sum_l[c + 1] += sum_s[c];
+  }
+
+  std::vector<index_type> buf(upper + 1);
+  const auto induce = [&](std::span<const index_type> lms) {
+    parallel::for_each_range(n, workers, [&](size_t beg, size_t end) {
+      std::fill(sa.begin() + beg, sa.begin() + end, nval);
+    });
+    std::copy(sum_s.begin(), sum_s.end(), buf.begin());
+    for (const auto d : lms) sa[buf[s[d]]++] = d;
+    std::copy(sum_l.begin(), sum_l.end(), buf.begin());
+    sa[buf[s[n - 1]]++] = n - 1;
+    for (size_t i = 0; i < n; ++i) {
+      const auto v = sa[i];
+      if (v != nval && v >= 1 && !ls[v - 1]) sa[buf[s[v - 1]]++] = v - 1;
+    }
+    std::copy(sum_l.begin(), sum_l.end(), buf.begin());
+    for (size_t i = n; i-- > 0; ) {
+      const auto v = sa[i];
+      if (v != nval && v >= 1 && ls[v - 1]) sa[--buf[s[v - 1] + 1]] = v - 1;
+    }
+  };
+
+  std::vector<index_type> lms_map(n, nval), lms;
+  collect(n, workers, lms, [&](size_t i) { return i > 0 && !ls[i - 1] && ls[i]; },
+          [](size_t i) { return i; });
+  const size_t m = lms.size();
+  parallel::for_each_range(m, workers, [&](size_t beg, size_t end) {
+    for (size_t i = beg; i < end; ++i) lms_map[lms[i]] = i;
+  });
+
+  induce(lms);
+  if (m == 0) return;
+
+  std::vector<index_type> sorted_lms;
+  sorted_lms.reserve(m);
+  collect(n, workers, sorted_lms, [&](size_t i) { return lms_map[sa[i]] != nval; },
+          [&](size_t i) { return sa[i]; });
+
+  // Name the LMS substrings and sort them recursively.
+  const auto differs = [&](size_t l, size_t r) {
+    const size_t end_l = (lms_map[l] + 1 < m) ? lms[lms_map[l] + 1] : n;
+    const size_t end_r = (lms_map[r] + 1 < m) ? lms[lms_map[r] + 1] : n;
+    if (end_l - l != end_r - r) return true;
+    for (; l < end_l && s[l] == s[r]; ++l, ++r);
+    return l == n || s[l] != s[r];
+  };
+  std::vector<index_type> rec_s(m), rec_sa(m);
+  parallel::for_each_range(m, workers, [&](size_t beg, size_t end) {
+    for (size_t i = std::max<size_t>(beg, 1); i < end; ++i) {
+      rec_sa[i] = differs(sorted_lms[i - 1], sorted_lms[i]);
+    }
+  });
+  size_t rec_upper = 0;
+  for (size_t i = 0; i < m; ++i) {
+    if (i > 0) rec_upper += rec_sa[i];
+    rec_s[lms_map[sorted_lms[i]]] = rec_upper;
+  }
+  lms_map = std::vector<index_type>();
+
+  sa_is<index_type, index_type>(rec_s, rec_upper, rec_sa, std::min(workers, parallel::workers(m)));
+  for (size_t i = 0; i < m; ++i) sorted_lms[i] = lms[rec_sa[i]];
+  induce(sorted_lms);
+}
+
+} // namespace detail
+
 template <typename ElementType, typename IndexType = uint32_t>
 requires std::integral<ElementType> && std::unsigned_integral<IndexType> &&
          (sizeof(ElementType) <= sizeof(IndexType))
@@ -16,60 +181,67 @@ public:
   using index_type = IndexType;
   using signed_index_type = std::make_signed_t<index_type>;
 
+private:
+  using char_type = std::make_unsigned_t<element_type>;
+  // SA-IS needs one extra value as an empty marker.
+  using work_type = std::conditional_t<(sizeof(index_type) < sizeof(uint32_t)), uint32_t, index_type>;
+
+public:
   suffix_array() = default;
-  suffix_array(std::span<const element_type> input) : input(input), sa(input.size()) {
+  suffix_array(std::span<const element_type> input)
+      : suffix_array(input, parallel::workers(input.size())) {}
+
+  suffix_array(std::span<const element_type> input, size_t workers)
+      : input(input), sa(input.size()), workers(workers) {
     const size_t n = input.size();
     if (n == 0) return;
 
-    for (size_t i = 0; i < n; ++i) sa[i] = i;
-    std::vector<signed_index_type> inv_sa(n), ninv_sa(n);
-    std::vector<index_type> psa(n);
-    for (size_t i = 0; i < n; ++i) inv_sa[i] = input[i];
-
-    std::sort(sa.begin(), sa.end(), [&] (const index_type a, const index_type b) {
-      return inv_sa[a] < inv_sa[b] || (inv_sa[a] == inv_sa[b] && a > b);
-    });
+    // Maps the symbols to [0, upper] without changing their order.
+    const auto [min_it, max_it] = std::minmax_element(input.begin(), input.end());
+    const element_type min_v = *min_it;
+    const size_t upper = char_type(*max_it - min_v);
 
-    std::vector<signed_index_type>& offsets = inv_sa;
-    for (size_t l = 1; l < n; l <<= 1) {
-      size_t lh = l >> 1;
-      index_type ps = sa[0]; signed_index_type u = inv_sa[ps];
-      ninv_sa[ps] = 0;
-      size_t r = 1;
-      for (size_t i = 1; i < n; ++i) {
-        index_type cs = sa[i]; signed_index_type v = inv_sa[cs];
-        if (u == v && ps + l < n && inv_sa[ps + lh] == inv_sa[cs + lh]) {
-          ninv_sa[cs] = ninv_sa[ps];
-        } else {
-          ninv_sa[cs] = i; ++r;
-        }
-        ps = cs; u = v;
-      }
-      if (r == n) break;
-      for (size_t i = 0; i < n; ++i) psa[i] = sa[i];
-      for (size_t i = 0; i < n; ++i) offsets[i] = i;
-      for (size_t i = 0; i < n; ++i) {
-        signed_index_type k = psa[i] - l;
-        if (k >= 0) sa[offsets[ninv_sa[k]]++] = k;
+    const auto build = [&](std::span<work_type> dest) {
+      if constexpr (std::is_unsigned_v<element_type>) {
+        if (min_v == 0) return detail::sa_is<work_type, char_type>(input, upper, dest, workers);
       }
-      std::swap(inv_sa, ninv_sa);
+      std::vector<char_type> s(n);
+      parallel::for_each_range(n, workers, [&](size_t beg, size_t end) {
+        for (size_t i = beg; i < end; ++i) s[i] = char_type(input[i] - min_v);
+      });
+      detail::sa_is<work_type, char_type>(s, upper, dest, workers);
+    };
+
+    if constexpr (std::is_same_v<work_type, index_type>) {
+      build(sa);
+    } else {
+      std::vector<work_type> w(n);
+      build(w);
+      std::copy(w.begin(), w.end(), sa.begin());
     }
   }
 
+  // Returns (lcp, rank), where lcp[r] is the length of the longest common prefix of
+  // the suffixes sa[r] and sa[r + 1] (Kasai et al.).
+  // With multiple workers, each worker runs the same scan over its own range of text positions.
   std::pair<std::vector<index_type>, std::vector<index_type>> lcp_rank() const {
     const size_t n = sa.size();
     std::vector<index_type> lcp(n, 0);
     std::vector<index_type> isa(n);
-    for (size_t i = 0; i < n; ++i) isa[sa[i]] = i;
-    size_t h = 0;
-    for (size_t i = 0; i < n; ++i) {
-      size_t r = isa[i];
-      if (r + 1 >= n) continue;
-      size_t j = sa[r + 1];
-      for (size_t o = std::max(i, j); o + h < n && input[i + h] == input[j + h]; ++h);
-      lcp[r] = h;
-      if (h > 0) --h;
-    }
+    parallel::for_each_range(n, workers, [&](size_t beg, size_t end) {
+      for (size_t i = beg; i < end; ++i) isa[sa[i]] = i;
+    });
+    parallel::for_each_range(n, workers, [&](size_t beg, size_t end) {
+      size_t h = 0;
+      for (size_t i = beg; i < end; ++i) {
+        size_t r = isa[i];
+        if (r + 1 >= n) continue;
+        size_t j = sa[r + 1];
+        for (size_t o = std::max(i, j); o + h < n && input[i + h] == input[j + h]; ++h);
+        lcp[r] = h;
+        if (h > 0) --h;
+      }
+    });
     return std::make_pair(std::move(lcp), std::move(isa));
   }
 
@@ -79,9 +251,15 @@ public:
     return sa[i];
   }
 
+  std::vector<index_type> release() && {
+    input = {};
+    return std::move(sa);
+  }
+
 private:
   std::span<const element_type> input;
   std::vector<index_type> sa;
+  size_t workers = 1;
 };
 
 template <typename T>
@@ -196,6 +374,152 @@ private:
   std::vector<value_type> tree;
 };
 
+// A segment tree whose nodes have `Arity` children stored next to each other.
+// Levels are stored from the leaves up and each of them is padded to a multiple of `Arity`,
+// so the siblings of a node can be scanned within one or two cache lines.
+// The topmost level has at most `Arity` nodes.
+template <typename T, size_t Arity = 8>
+requires monoid<T> && (Arity >= 2)
+class wide_segment_tree {
+public:
+  using value_type = typename T::value_type;
+  static constexpr value_type iden = T::iden();
+  static constexpr size_t arity = Arity;
+
+  wide_segment_tree() = default;
+  wide_segment_tree(const size_t n) : n(n) {
+    size_t total = 0;
+    for (size_t s = n; ; s = (s + Arity - 1) / Arity) {
+      total += (s + Arity - 1) / Arity * Arity;
+      offsets.push_back(total);
+      if (s <= Arity) break;
+    }
+    tree.assign(total, T::iden());
+  }
+
+  wide_segment_tree(std::span<const value_type> arr) : wide_segment_tree(arr.size()) {
+    init([&](size_t i) { return arr[i]; });
+  }
+
+  template <typename Func>
+  requires std::convertible_to<std::invoke_result_t<Func, size_t>, value_type>
+  void init(Func&& func) {
+    for (size_t i = 0; i < n; ++i) tree[i] = func(i);
+    for (size_t l = 1; l < levels(); ++l) {
+      const auto lower = level(l - 1);
+      const auto upper = mutable_level(l);
+      for (size_t k = 0; k < lower.size() / Arity; ++k) upper[k] = fold_block(lower, k * Arity);
+    }
+  }
+
+  template <typename Func>
+  requires std::predicate<Func, value_type>
+  std::pair<size_t, size_t> find_range(size_t i, Func&& func) const {
+    size_t right = find_right(i, func);
+    size_t left = find_left(i, func);
+    return std::make_pair(left + 1, right);
+  }
+
+  // Returns the first index j >= i such that !func(tree[j]), or n if there is no such index.
+  template <typename Func>
+  requires std::predicate<Func, value_type>
+  ptrdiff_t find_right(size_t i, Func&& func) const {
+    size_t l = 0, k = i;
+    for (;; ++l, k /= Arity) {
+      const auto nodes = level(l);
+      if (k == nodes.size()) return n;
+      const size_t e = k - k % Arity + Arity;
+      for (; k < e; ++k) if (!func(nodes[k])) break;
+      if (k < e) break;
+      if (l + 1 == levels()) return n;
+    }
+    for (; l > 0; --l) {
+      const auto nodes = level(l - 1);
+      for (k *= Arity; func(nodes[k]); ++k);
+    }
+    return k;
+  }
+
+  // Returns the last index j < i such that !func(tree[j]), or -1 if there is no such index.
+  template <typename Func>
+  requires std::predicate<Func, value_type>
+  ptrdiff_t find_left(size_t i, Func&& func) const {
+    size_t l = 0, k = i;
+    for (;; ++l, k /= Arity) {
+      const auto nodes = level(l);
+      const size_t b = k - k % Arity;
+      while (k > b && func(nodes[k - 1])) --k;
+      if (k > b) { --k; break; }
+      if (b == 0) return -1;
+    }
+    for (; l > 0; --l) {
+      const auto nodes = level(l - 1);
+      for (k = k * Arity + Arity - 1; func(nodes[k]); --k);
+    }
+    return k;
+  }
+
+  value_type operator [] (const size_t i) const {
+    return tree[i];
+  }
+
+  void update(size_t k, value_type v) {
+    tree[k] = v;
+    for (size_t l = 1; l < levels(); ++l) {
+      const auto folded = fold_block(level(l - 1), k - k % Arity);
+      k /= Arity;
+      auto& node = mutable_level(l)[k];
+      if (node == folded) break;
+      node = folded;
+    }
+  }
+
+  void reset(size_t k) {
+    return update(k, T::iden());
+  }
+
+  value_type fold(size_t lo, size_t hi) const {
+    value_type ret_l = T::iden(), ret_r = T::iden();
+    for (size_t l = 0; lo < hi; ++l, lo /= Arity, hi /= Arity) {
+      const auto nodes = level(l);
+      for (; lo < hi && lo % Arity != 0; ++lo) ret_l = T::op(ret_l, nodes[lo]);
+      for (; lo < hi && hi % Arity != 0; ) ret_r = T::op(nodes[--hi], ret_r);
+      if (lo < hi && l + 1 == levels()) {
+        for (; lo < hi; ++lo) ret_l = T::op(ret_l, nodes[lo]);
+      }
+    }
+    return T::op(ret_l, ret_r);
+  }
+
+  size_t size() const {
+    return n;
+  }
+
+  size_t levels() const {
+    return offsets.size() - 1;
+  }
+
+  // The nodes of the l-th level from the bottom. Level 0 holds the leaves.
+  std::span<const value_type> level(size_t l) const {
+    return std::span(tree.data() + offsets[l], offsets[l + 1] - offsets[l]);
+  }
+
+private:
+  std::span<value_type> mutable_level(size_t l) {
+    return std::span(tree.data() + offsets[l], offsets[l + 1] - offsets[l]);
+  }
+
+  static value_type fold_block(std::span<const value_type> nodes, size_t b) {
+    value_type ret = nodes[b];
+    for (size_t i = 1; i < Arity; ++i) ret = T::op(ret, nodes[b + i]);
+    return ret;
+  }
+
+  size_t n = 0;
+  std::vector<size_t> offsets = {0};
+  std::vector<value_type> tree;
+};
+
 template <typename T>
 requires std::unsigned_integral<T>
 class wavelet_matrix {
@@ -204,24 +528,27 @@ class wavelet_matrix {
   static constexpr value_type nval = value_type(-1);
 
  private:
-  using block_type = uint64_t;
-  static constexpr size_t block_size = sizeof(block_type);
-
-  struct counter {
-    size_t cumu;
-    block_type f;
+  // Each level is a bit-packed vector of 64-byte lines holding 384 bits each.
+  // A line starts with the number of set bits before it and the (9-bit) numbers of set bits
+  // before each of its words, so that rank reads a single cache line.
+  struct alignas(64) line {
+    uint64_t cumu;
+    uint64_t counts;
+    std::array<uint64_t, 6> words;
   };
+  static constexpr size_t line_bits = 64 * 6;
 
   size_t rank(size_t b, size_t i) const {
-    const auto c = bit_vectors[b * vector_size + (i / block_size)];
-    const auto mask = (block_type(1) << (i % block_size)) - 1;
-    return c.cumu + std::popcount(c.f & mask);
+    const auto& l = bit_vectors[b * vector_size + i / line_bits];
+    const size_t r = i % line_bits, w = r / 64;
+    const auto mask = (uint64_t(1) << (r % 64)) - 1;
+    return l.cumu + ((l.counts >> (9 * w)) & 0x1ff) + std::popcount(l.words[w] & mask);
   }
 
  public:
   wavelet_matrix() = default;
   wavelet_matrix(std::span<const value_type> input)
-      : n(input.size()), vector_size(1 + n / block_size) {
+      : n(input.size()), vector_size(1 + n / line_bits) {
     max_v = 0;
     for (const auto v : input) max_v = std::max(max_v, v);
     bit_width = std::bit_width(max_v);
@@ -275,12 +602,16 @@ class wavelet_matrix {
           t[ti++] = v;
         } else {
           s[si++] = v;
-          bv[i / block_size].f |= block_type(1) << (i % block_size);
+          bv[i / line_bits].words[(i % line_bits) / 64] |= uint64_t(1) << (i % 64);
         }
       }
-      bv[0].cumu = 0;
-      for (size_t i = 1; i < vector_size; ++i) {
-        bv[i].cumu = bv[i - 1].cumu + std::popcount(bv[i - 1].f);
+      size_t cumu = 0;
+      for (auto& l : bv) {
+        l.cumu = cumu;
+        for (size_t w = 0; w < l.words.size(); ++w) {
+          l.counts |= uint64_t(cumu - l.cumu) << (9 * w);
+          cumu += std::popcount(l.words[w]);
+        }
       }
       zeros[b] = si;
       std::copy_n(t.begin(), ti, s.begin() + si);
@@ -292,7 +623,7 @@ class wavelet_matrix {
   size_t vector_size;
   value_type max_v;
   size_t bit_width;
-  std::vector<counter> bit_vectors;
+  std::vector<line> bit_vectors;
   std::vector<size_t> zeros;
 };
 
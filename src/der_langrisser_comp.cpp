@@ -33,7 +33,7 @@ std::vector<uint8_t> der_langrisser_comp(std::span<const uint8_t> input) {
     return {10, 0x300 | i};
   });
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, lens_s.front().min, lens_l.back().max);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(lens_l.back().max);
 
@@ -24,15 +24,17 @@ std::vector<uint8_t> derby_stallion_2_comp(std::span<const uint8_t> input) {
     {0x0010,  9, 0b0000'00000},
   }, 0x002f);
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, len_tab.front().min, len_tab.back().max);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(len_tab.back().max);
 
+  std::array<encode::lz_data, ofs_tab.size()> lz_memo;
   for (size_t i = input.size(); i-- > 0; ) {
     lz_helper.reset(i);
     dp.update(i, 1, 9, {uncomp, 0, 0});
+    lz_helper.find_all(i, ofs_tab, len_tab.front().min, lz_memo);
     dp.update_matrix(i, ofs_tab, len_tab, c0, 1,
-      [&](size_t oi) { return lz_helper.find(i, ofs_tab[oi].max, len_tab.front().min); },
+      [&](size_t oi) { return lz_memo[oi]; },
       [&](size_t oi, size_t li) -> tag { return {lz, oi, li}; }
     );
     c0.update(i);
@@ -5,8 +5,7 @@ namespace sfc_comp {
 std::vector<uint8_t> dokapon_comp(std::span<const uint8_t> input) {
   check_size(input.size(), 0, 0x8000);
 
-  std::vector<uint8_t> best;
-  for (size_t comp_ty = 0; comp_ty < 8; ++comp_ty) {
+  return parallel::best_of(8, input.size(), [&](size_t comp_ty, const parallel::candidate& cand) {
     const size_t min_len = 2;
     const size_t max_len = min_len + ((2 << comp_ty) - 1);
     const size_t max_ofs = 0x8000 >> comp_ty;
@@ -17,13 +16,15 @@ std::vector<uint8_t> dokapon_comp(std::span<const uint8_t> input) {
       [&](size_t i, size_t o, size_t l) {
         size_t d = i - o;
         return ((d - 1) & 0x00ff) << 8 | (l - 2) << (7 - comp_ty) | (d - 1) >> 8;
-      }
+      },
+      [&](size_t bound) { return cand.beaten(bound); }
     );
-    write16(compressed, 0, input.size());
-    compressed[2] = comp_ty + 1;
-    if (best.empty() || compressed.size() < best.size()) best = std::move(compressed);
-  }
-  return best;
+    if (compressed) {
+      write16(*compressed, 0, input.size());
+      (*compressed)[2] = comp_ty + 1;
+    }
+    return compressed;
+  });
 }
 
 } // namespace sfc_comp
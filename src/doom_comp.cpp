@@ -11,9 +11,9 @@ std::vector<uint8_t> doom_comp_04(std::span<const uint8_t> in) {
 
   std::vector<uint8_t> input(in.rbegin(), in.rend());
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 2, 0x104);
   solver<tag> dp(input.size());
-  auto c0 = dp.c<0>(0x104);
+  auto c0 = dp.c_mono<0>(5, 0x104);
   auto c8 = dp.c<8>(0x108);
 
   for (size_t i = input.size(); i-- > 0; ) {
@@ -32,6 +32,7 @@ std::vector<uint8_t> doom_comp_04(std::span<const uint8_t> in) {
 
   using namespace data_type;
   writer_b16_l ret(4); ret.write<b1>(0);
+  ret.reserve((dp.optimal_cost() + 1 + 4 * 8 + 15) / 16 * 2);
 
   size_t adr = 0;
   for (const auto& cmd : dp.optimal_path()) {
@@ -50,11 +51,10 @@ std::vector<uint8_t> doom_comp_04(std::span<const uint8_t> in) {
   write16(ret.out, 0, in.size());
   write16(ret.out, 2, ret.size() - 2);
   write16(ret.out, 4, 0x8000 | (read16(ret.out, 4) >> 1));
-  std::reverse(ret.out.begin() + 4, ret.out.end());
-  for (size_t i = 4; i < ret.size(); i += 2) std::swap(ret.out[i], ret.out[i + 1]);
+  ret.reverse_blocks(4);
   assert(adr == in.size());
   assert(dp.optimal_cost() + 1 + 4 * 8 == ret.bit_length());
-  return ret.out;
+  return std::move(ret.out);
 }
 
 std::vector<uint8_t> doom_comp_08(std::span<const uint8_t> in) {
@@ -63,7 +63,7 @@ std::vector<uint8_t> doom_comp_08(std::span<const uint8_t> in) {
 
   std::vector<uint8_t> input(in.rbegin(), in.rend());
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 1, 0x12);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(0x21);
   auto c1 = dp.c<1>(0x40);
@@ -85,6 +85,7 @@ std::vector<uint8_t> doom_comp_08(std::span<const uint8_t> in) {
 
   using namespace data_type;
   writer ret; ret.write<d16, d8>(0, 0x01);
+  ret.reserve(dp.optimal_cost() + 4);
   size_t adr = 0;
   for (const auto& cmd : dp.optimal_path()) {
     size_t d = adr - cmd.lz_ofs();
@@ -110,7 +111,7 @@ std::vector<uint8_t> doom_comp_08(std::span<const uint8_t> in) {
   ret.write<d8>(0x00);
   assert(adr == in.size());
   assert(dp.optimal_cost() + 4 == ret.size());
-  return ret.out;
+  return std::move(ret.out);
 }
 
 namespace {
@@ -194,6 +195,7 @@ std::vector<uint8_t> doom_comp_0c(std::span<const uint8_t> input) {
 
   using namespace data_type;
   writer ret; ret.write<d16, d8>(0, 0x02);
+  ret.reserve(3 + dp_odd.optimal_cost() + dp_even.optimal_cost() + 1);
 
   for (size_t k = 0; k < 2; ++k) {
     size_t adr = 0;
@@ -228,22 +230,22 @@ std::vector<uint8_t> doom_comp_0c(std::span<const uint8_t> input) {
   ret.write<d8>(0x00);
   write16(ret.out, 0, input.size());
   assert(3 + dp_odd.optimal_cost() + dp_even.optimal_cost() + 1 == ret.size());
-  return ret.out;
+  return std::move(ret.out);
 }
 
 std::vector<uint8_t> doom_comp_1(std::span<const uint8_t> input) {
-  std::vector<uint8_t> ret = doom_comp_04(input);
+  std::vector<uint8_t> best = doom_comp_04(input);
   size_t comp_type = 1;
 
-  if (auto res = doom_comp_08(input); res.size() < ret.size()) {
-    ret = std::move(res); comp_type = 2;
+  if (auto res = doom_comp_08(input); res.size() < best.size()) {
+    best = std::move(res); comp_type = 2;
   }
-  if (auto res = doom_comp_0c(input); res.size() < ret.size()) {
-    ret = std::move(res); comp_type = 3;
+  if (auto res = doom_comp_0c(input); res.size() < best.size()) {
+    best = std::move(res); comp_type = 3;
   }
-  ret.resize(ret.size() + 2);
-  for (size_t i = 0; i < ret.size() - 2; ++i) ret[ret.size() - 1 - i] = ret[ret.size() - 3 - i];
+  std::vector<uint8_t> ret(best.size() + 2);
   write16(ret, 0, comp_type << 2);
+  std::ranges::copy(best, ret.begin() + 2);
 
   return ret;
 }
@@ -2,6 +2,8 @@
 
 #include "algorithm.hpp"
 #include "encode.hpp"
+#include "parallel.hpp"
+#include "refine.hpp"
 #include "utility.hpp"
 #include "writer.hpp"
 
@@ -106,21 +108,25 @@ std::vector<uint8_t> doraemon_comp_core(
   });
 
   const auto lz_memo = [&] {
-    std::vector<std::array<encode::lz_data, lz_ofs_max_bits + 1>> ret(input.size());
-    lz_helper lz_helper(input);
+    lz_memo_table ret(lz_ofs.size()); ret.reserve(input.size());
+    std::array<encode::lz_data, lz_ofs_max_bits + 1> res_lz;
+    level_lz_helper lz_helper(input, false, lz_min_len, lz_max_len);
     for (size_t i = 0; i < input.size(); ++i) {
-      encode::lz::find_all(i, lz_ofs, lz_min_len, ret[i], [&](size_t max_ofs) {
-        return lz_helper.find(i, max_ofs, lz_min_len);
-      });
+      lz_helper.find_all(i, lz_ofs, lz_min_len, res_lz);
+      ret.push_back(std::span(res_lz).first(lz_ofs.size()));
       lz_helper.add_element(i);
     }
     return ret;
   }();
 
-  using namespace data_type;
-  writer_b8_h ret(config.header_size);
+  using node_type = solver<tag>::node;
+  struct chunk {
+    std::vector<node_type> commands;
+    encodes enc;
+  };
 
-  for (size_t begin = 0; begin < input.size(); ) {
+  // Chunks only share lz_memo, so their codes can be optimized independently.
+  const auto optimize = [&](const size_t begin) {
     const size_t end = std::min<size_t>(begin + chunk_size, input.size());
     const size_t size = end - begin;
 
@@ -134,13 +140,12 @@ std::vector<uint8_t> doraemon_comp_core(
     std::vector<vrange> curr_ofs(lz_ofs.begin(), lz_ofs.end());
     for (auto& v : curr_ofs) v.bitlen += 4;
 
-    using node_type = solver<tag>::node;
-    size_t best_cost = std::numeric_limits<size_t>::max();
     std::vector<node_type> best_commands;
     encodes best_enc;
 
-    for (bool updated = true; updated; ) {
-      solver<tag> dp(size);
+    solver<tag> dp(size);
+    for (refinement refine; refine.next(); ) {
+      if (refine.iterations() > 1) dp.reset();
 
       const auto shift_lz = [&](const encode::lz_data& p) -> encode::lz_data {
         return {p.ofs - begin, p.len}; // Note: can be negative
@@ -202,110 +207,115 @@ std::vector<uint8_t> doraemon_comp_core(
         .bits = encode_table(enc.code)
       };
 
-      const size_t estimated_cost = calc_cost(enc, counter);
-      if (estimated_cost < best_cost) {
-        best_cost = estimated_cost;
+      if (refine.improved(calc_cost(enc, counter))) {
         best_commands = std::move(commands);
         best_enc = std::move(enc);
         update_costs(best_enc);
-      } else {
-        updated = false;
       }
     }
+    return chunk{std::move(best_commands), std::move(best_enc)};
+  };
 
-    const auto write_huff_bits = [&](const encode::huffman_t& huff, const size_t s, const size_t t, const size_t lim, const h_tag tag) {
-      auto bits = bits_table(huff);
-      if (bits.size() > lim) std::runtime_error("This algorithm cannot compress the given data.");
-      if (!config.allow_empty) {
-        if (huff.words.size() == 0) {
-          ret.write<bnh>({s, 1});
-          ret.write<bnh>({3, 0});
-          return;
-        }
+  using namespace data_type;
+  writer_b8_h ret(config.header_size);
+
+  const auto write_huff_bits = [&](const encode::huffman_t& huff, const size_t s, const size_t t, const size_t lim, const h_tag tag) {
+    auto bits = bits_table(huff);
+    if (bits.size() > lim) std::runtime_error("This algorithm cannot compress the given data.");
+    if (!config.allow_empty) {
+      if (huff.words.size() == 0) {
+        ret.write<bnh>({s, 1});
+        ret.write<bnh>({3, 0});
+        return;
       }
+    }
 
-      if (config.use_old_encoding) {
-        if (huff.words.size() == 0) {
-          ret.write<bnh>({s, 1});
-          ret.write<bnh>({3, 0});
+    if (config.use_old_encoding) {
+      if (huff.words.size() == 0) {
+        ret.write<bnh>({s, 1});
+        ret.write<bnh>({3, 0});
+        return;
+      } else if (huff.words.size() == 1) {
+        if (config.allow_zero_bits(tag, huff.words[0])) {
+          // Caution: These codes might not work on the original LHA algorithm.
+          ret.write<bnh>({s, 0});
+          ret.write<bnh>({s, huff.words[0]});
           return;
-        } else if (huff.words.size() == 1) {
-          if (config.allow_zero_bits(tag, huff.words[0])) {
-            // Caution: These codes might not work on the original LHA algorithm.
-            ret.write<bnh>({s, 0});
-            ret.write<bnh>({s, huff.words[0]});
-            return;
-          }
         }
       }
+    }
 
-      ret.write<bnh>({s, bits.size()});
-      for (size_t i = 0; i < bits.size(); ) {
-        if (bits[i] < 7) {
-          ret.write<bnh>({3, bits[i]});
-        } else {
-          ret.write<bnh>({3, 7});
-          for (size_t j = bits[i]; j >= 8; --j) ret.write<bnh>({1, 1});
-          ret.write<bnh>({1, 0});
-        }
-        i += 1;
-        if (i == t) {
-          size_t l = encode::run_length(bits, i, 0);
-          l = std::min<size_t>(l, 3);
-          if (bits[i] != 0) l = 0;
-          ret.write<bnh>({2, l});
-          i += l;
-        }
+    ret.write<bnh>({s, bits.size()});
+    for (size_t i = 0; i < bits.size(); ) {
+      if (bits[i] < 7) {
+        ret.write<bnh>({3, bits[i]});
+      } else {
+        ret.write<bnh>({3, 7});
+        for (size_t j = bits[i]; j >= 8; --j) ret.write<bnh>({1, 1});
+        ret.write<bnh>({1, 0});
       }
-    };
+      i += 1;
+      if (i == t) {
+        size_t l = encode::run_length(bits, i, 0);
+        l = std::min<size_t>(l, 3);
+        if (bits[i] != 0) l = 0;
+        ret.write<bnh>({2, l});
+        i += l;
+      }
+    }
+  };
 
-    const auto write_table = [&](const encodes& enc) {
-      const auto table = bits_table(enc.code);
+  const auto write_table = [&](const encodes& enc) {
+    const auto table = bits_table(enc.code);
 
-      const auto& words = enc.code.words;
-      if (words.size() == 0) throw std::logic_error("Nothing to compress.");
+    const auto& words = enc.code.words;
+    if (words.size() == 0) throw std::logic_error("Nothing to compress.");
 
-      if (config.use_old_encoding) {
-        if (words.size() == 1) {
-          if (config.allow_zero_bits(h_tag::code, words[0])) {
-            // Caution: These codes might not work on the original LHA algorithm.
-            ret.write<bnh>({9, 0});
-            ret.write<bnh>({9, words[0]});
-            return;
-          }
+    if (config.use_old_encoding) {
+      if (words.size() == 1) {
+        if (config.allow_zero_bits(h_tag::code, words[0])) {
+          // Caution: These codes might not work on the original LHA algorithm.
+          ret.write<bnh>({9, 0});
+          ret.write<bnh>({9, words[0]});
+          return;
         }
       }
+    }
 
-      const auto write_zeros = [&](size_t l, const size_t z_code, const size_t b, const size_t min_len) -> size_t {
-        const size_t max_len = min_len + (1 << b) - 1;
-        while (l >= min_len) {
-          const size_t t = std::min<size_t>(l, max_len);
-          ret.write<bnh>(enc.bits.code[z_code]);
-          ret.write<bnh>({b, t - min_len});
-          l -= t;
-        }
-        return l;
-      };
+    const auto write_zeros = [&](size_t l, const size_t z_code, const size_t b, const size_t min_len) -> size_t {
+      const size_t max_len = min_len + (1 << b) - 1;
+      while (l >= min_len) {
+        const size_t t = std::min<size_t>(l, max_len);
+        ret.write<bnh>(enc.bits.code[z_code]);
+        ret.write<bnh>({b, t - min_len});
+        l -= t;
+      }
+      return l;
+    };
 
-      ret.write<bnh>({9, table.size()});
-      for (size_t i = 0; i < table.size(); ) {
-        if (table[i] == 0) {
-          size_t l = encode::run_length(table, i, 0);
-          i += l;
-          l = write_zeros(l, 2, 9, 0x14);
-          l = write_zeros(l, 1, 4, 0x03);
-          l = write_zeros(l, 0, 0, 0x01);
-          assert(l == 0);
-        } else {
-          if (table[i] > config.max_bitlen[h_tag::code]) {
-            // this should not happen.
-            throw std::logic_error("This algorithm cannot compress the given data.");
-          }
-          ret.write<bnh>(enc.bits.code[table[i] + 2]);
-          i += 1;
+    ret.write<bnh>({9, table.size()});
+    for (size_t i = 0; i < table.size(); ) {
+      if (table[i] == 0) {
+        size_t l = encode::run_length(table, i, 0);
+        i += l;
+        l = write_zeros(l, 2, 9, 0x14);
+        l = write_zeros(l, 1, 4, 0x03);
+        l = write_zeros(l, 0, 0, 0x01);
+        assert(l == 0);
+      } else {
+        if (table[i] > config.max_bitlen[h_tag::code]) {
+          // this should not happen.
+          throw std::logic_error("This algorithm cannot compress the given data.");
         }
+        ret.write<bnh>(enc.bits.code[table[i] + 2]);
+        i += 1;
       }
-    };
+    }
+  };
+
+  const auto write = [&](const size_t begin, const chunk& best) {
+    [[maybe_unused]] const size_t size = std::min<size_t>(chunk_size, input.size() - begin);
+    const auto& [best_commands, best_enc] = best;
 
     ret.write<bnh>({16, best_commands.size()});
     write_huff_bits(best_enc.bits, 5, 3, 0x13, h_tag::bits);
@@ -332,8 +342,12 @@ std::vector<uint8_t> doraemon_comp_core(
       adr += cmd.len;
     }
     assert(adr == size);
-    begin = end;
-  }
+  };
+
+  const size_t chunks = (input.size() + chunk_size - 1) / chunk_size;
+  parallel::produce_in_order(chunks, parallel::workers(input.size()),
+    [&](size_t c) { return optimize(c * chunk_size); },
+    [&](size_t c, const chunk& result) { write(c * chunk_size, result); });
   return ret.out;
 }
 
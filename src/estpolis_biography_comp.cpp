@@ -10,7 +10,7 @@ std::vector<uint8_t> estpolis_biography_comp(std::span<const uint8_t> input) {
 
   enum tag { uncomp0, uncomp1, lzs, lzl };
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 3, 0x42);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(0x42);
 
@@ -15,7 +15,7 @@ std::vector<uint8_t> fe3_comp(std::span<const uint8_t> input) {
   using tag = tag_l<method>;
   static constexpr auto lens = to_vranges({{0x0001, 1, 0}, {0x0021, 2, 0}}, 0x0400);
 
-  lz_helper_c lz_helper(input, true);
+  level_lz_helper<lz_helper_c<>> lz_helper(input, true, 2, lens.back().max);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(lens.back().max);
   auto c1 = dp.c<1>(lens.back().max);
@@ -34,17 +34,21 @@ std::vector<uint8_t> fe3_comp(std::span<const uint8_t> input) {
 
     dp.update(i, lens, lz_helper.find(i, 0x10000, 3), c0, 2,
       [&](size_t li) -> tag { return {lz, li}; });
-    dp.update(i, lens, lz_helper.find_c(i, 0x10000, 3), c0, 2,
-      [&](size_t li) -> tag { return {lzc, li}; });
+    const auto* h = lz_helper.optimal();
+    if (h) {
+      dp.update(i, lens, h->find_c(i, 0x10000, 3), c0, 2,
+        [&](size_t li) -> tag { return {lzc, li}; });
+    }
     dp.update(i, lens, lz_helper.find(i, 0xff, 2), c0, 1,
       [&](size_t li) -> tag { return {lzs, li}; });
-    dp.update(i, 1, 0x300, lz_helper.find_c(i, 0xff, 3), c0, 3, {lzcs, 1});
+    if (h) dp.update(i, 1, 0x300, h->find_c(i, 0xff, 3), c0, 3, {lzcs, 1});
 
     c0.update(i); c1.update(i);
   }
 
   using namespace data_type;
   writer ret;
+  ret.reserve(dp.optimal_cost() + 1);
   size_t adr = 0;
   for (const auto& cmd : dp.optimal_path()) {
     const auto [tag, li] = cmd.type;
@@ -66,7 +70,7 @@ std::vector<uint8_t> fe3_comp(std::span<const uint8_t> input) {
   assert(dp.optimal_cost() == ret.size());
   assert(adr == input.size());
   ret.write<d8>(0xff);
-  return ret.out;
+  return std::move(ret.out);
 }
 
 } // namespace sfc_comp
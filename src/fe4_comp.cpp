@@ -233,7 +233,7 @@ std::vector<uint8_t> fe4_comp(std::span<const uint8_t> input) {
     rle, rlel,
   };
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 2, 0x41);
   solver<tag> dp(input.size());
 
   using L = std::less<size_t>;
@@ -10,7 +10,7 @@ std::vector<uint8_t> ffusa_comp(std::span<const uint8_t> input) {
 
   enum tag { uncomp, lz, lz_none };
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 3, 0x11);
   solver<tag> dp0(input.size()), dp1(input.size());
   auto c0_0 = dp0.c<0>(0x11);
   auto c1_1 = dp1.c<1>(0x0f);
@@ -27,7 +27,7 @@ std::vector<uint8_t> flintstones_comp(std::span<const uint8_t> input) {
     lzl
   };
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 2, 0x43);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(9 + 0x3f);
 
@@ -10,7 +10,7 @@ std::vector<uint8_t> front_mission_comp_2(std::span<const uint8_t> input) {
 
   enum tag { uncomp, rle, lz };
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 4, 0x12);
   if (input.size() > 0) lz_helper.reset(input.size() - 1);
 
   solver<tag> dp(input.size());
@@ -107,21 +107,16 @@ constexpr auto file_header = std::to_array<uint8_t>({0x59, 0x41, 0x4D, 0x43, 0x5
 std::vector<uint8_t> gokinjo_boukentai_comp(std::span<const uint8_t> input) {
   static constexpr size_t header_size = 16;
 
-  size_t comp_type = 3;
-  auto best = gokinjo_boukentai_comp_3(input, header_size);
-
-  if (auto res = gokinjo_boukentai_comp_2(input, header_size); res.size() < best.size()) {
-    best = std::move(res); comp_type = 2;
-  }
-
-  if (input.size() > 0) {
-    if (auto res = gokinjo_boukentai_comp_1(input, header_size); res.size() < best.size()) {
-      best = std::move(res); comp_type = 1;
-    }
-  }
+  static constexpr auto methods = std::to_array({
+    gokinjo_boukentai_comp_3, gokinjo_boukentai_comp_2, gokinjo_boukentai_comp_1
+  });
+  auto best = parallel::best_of(input.size() > 0 ? 3 : 2, input.size(), [&](size_t k) {
+    auto res = methods[k](input, header_size);
+    res[6] = 3 - k; // comp_type
+    return res;
+  });
 
   std::ranges::copy(file_header, best.begin());
-  best[6] = comp_type;
   write16(best, 7, input.size());
 
   return best;
@@ -203,7 +203,7 @@ std::vector<uint8_t> gun_hazard_comp_4(std::span<const uint8_t> input, const uin
 
   enum tag { uncomp, lzs, lzl, lzll };
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 3, 256);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(256);
 
@@ -16,7 +16,7 @@ std::vector<uint8_t> hal_comp(std::span<const uint8_t> input) {
   static constexpr auto lens = to_vranges({{0x0001, 1, 0}, {0x0021, 2, 0}}, 0x0400);
   static constexpr auto lens2 = to_vranges({{0x0002, 1, 0}, {0x0042, 2, 0}}, 0x0800);
 
-  lz_helper_kirby lz_helper(input, true);
+  level_lz_helper<lz_helper_kirby<>> lz_helper(input, true, 3, lens.back().max);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(lens.back().max);
   auto c1 = dp.c<1>(lens.back().max);
@@ -34,14 +34,17 @@ std::vector<uint8_t> hal_comp(std::span<const uint8_t> input) {
     rleni = encode::run_length_r(input, i, rleni, 1);
     dp.update(i, lens, rleni, c0, 1, [&](size_t li) -> tag { return {inc, li}; });
     dp.update(i, lens, lz_helper.find(i, 0x10000, 3), c0, 2, [&](size_t li) -> tag { return {lz, li}; });
-    dp.update(i, lens, lz_helper.find_h(i, 0x10000, 3), c0, 2, [&](size_t li) -> tag { return {lzh, li}; });
-    dp.update(i, lens, lz_helper.find_v(i, 0x10000, 3), c0, 2, [&](size_t li) -> tag { return {lzv, li}; });
+    if (const auto* h = lz_helper.optimal()) {
+      dp.update(i, lens, h->find_h(i, 0x10000, 3), c0, 2, [&](size_t li) -> tag { return {lzh, li}; });
+      dp.update(i, lens, h->find_v(i, 0x10000, 3), c0, 2, [&](size_t li) -> tag { return {lzv, li}; });
+    }
 
     c0.update(i); c0_2.update(i); c1.update(i);
   }
 
   using namespace data_type;
   writer ret;
+  ret.reserve(dp.optimal_cost() + 1);
   size_t adr = 0;
   for (const auto& cmd : dp.optimal_path()) {
     const auto [tag, li] = cmd.type;
@@ -64,7 +67,7 @@ std::vector<uint8_t> hal_comp(std::span<const uint8_t> input) {
   assert(dp.optimal_cost() == ret.size());
   assert(adr == input.size());
   ret.write<d8>(0xff);
-  return ret.out;
+  return std::move(ret.out);
 }
 
 } // namespace sfc_comp
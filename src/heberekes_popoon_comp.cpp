@@ -1,5 +1,6 @@
 #include "algorithm.hpp"
 #include "encode.hpp"
+#include "refine.hpp"
 #include "utility.hpp"
 #include "writer.hpp"
 
@@ -21,7 +22,7 @@ std::vector<uint8_t> heberekes_popoon_comp(std::span<const uint8_t> input) {
   static constexpr size_t pre_dist_size = 0x0e;
   static constexpr size_t pre_len_size = 0x0f;
 
-  lz_helper lz_helper(input);
+  level_lz_helper lz_helper(input, false, 1, max_len);
   std::vector<encode::lz_data> lz_memo(input.size());
 
   size_t longest_lz_len = 0, longest_lz_dist = 0;
@@ -55,8 +56,10 @@ std::vector<uint8_t> heberekes_popoon_comp(std::span<const uint8_t> input) {
   std::vector<size_t> dists(longest_lz_dist); std::iota(dists.begin(), dists.end(), 1);
 
   const size_t iter_total = pre_sizes.size();
-  for (size_t iter = 0; iter < iter_total; ++iter) {
-    solver<tag> dp(input.size());
+  solver<tag> dp(input.size());
+  refinement refine;
+  for (size_t iter = 0, next = 1; iter < iter_total && refine.next(); iter = next) {
+    if (iter > 0) dp.reset();
     auto c0 = dp.c<0>(max_len);
     auto c1 = dp.c<1>(0x100);
 
@@ -101,11 +104,13 @@ std::vector<uint8_t> heberekes_popoon_comp(std::span<const uint8_t> input) {
         vals.resize(nsize);
         std::sort(vals.begin(), vals.end());
       };
-      update(lens, pre_sizes[iter + 1].len, len_count);
-      update(dists, pre_sizes[iter + 1].dist, dist_count);
+      next = refine.next_step(iter, iter_total);
+      update(lens, pre_sizes[next].len, len_count);
+      update(dists, pre_sizes[next].dist, dist_count);
     } else {
       using namespace data_type;
       writer ret(0x21);
+      ret.reserve(dp.optimal_cost() + 0x21);
 
       size_t adr = 0;
       for (const auto& cmd : dp.optimal_path()) {
@@ -126,7 +131,7 @@ std::vector<uint8_t> heberekes_popoon_comp(std::span<const uint8_t> input) {
       for (size_t i = 0; i < lens.size(); ++i) ret[0x12 + i] = lens[i] & 0xff;
       assert(adr == input.size());
       assert(dp.optimal_cost() + 0x21 == ret.size());
-      return ret.out;
+      return std::move(ret.out);
     }
   }
   throw std::logic_error("iter_total == 0");
@@ -1,6 +1,8 @@
 #include <cassert>
 
+#include <algorithm>
 #include <stdexcept>
+#include <utility>
 
 #include "huffman.hpp"
 #include "utility.hpp"
@@ -12,6 +14,23 @@ namespace encode {
 namespace {
 
 using Leaf = std::pair<ptrdiff_t, size_t>;
+using Count = std::pair<ptrdiff_t, size_t>;
+
+// Buffers reused by the calls on the same thread, since the refinement loops rebuild codes
+// on every iteration.
+struct scratch {
+  std::vector<size_t> words;
+  std::vector<Count> weights;
+  std::vector<Count> items, next_items;
+  std::vector<node> nodes;
+  std::vector<size_t> depth;
+  std::vector<Leaf> leaves;
+};
+
+scratch& local_scratch() {
+  thread_local scratch s;
+  return s;
+}
 
 huffman_t create_codewords(const size_t n, std::vector<Leaf>& leaves, bool zero_to_one) {
   std::sort(leaves.begin(), leaves.end());
@@ -41,10 +60,9 @@ huffman_t create_codewords(const size_t n, std::vector<Leaf>& leaves, bool zero_
 } // namespace
 
 huffman_t length_limited_huffman(std::span<const size_t> counts, const size_t limit, bool zero_to_one) {
-  using Count = std::pair<ptrdiff_t, size_t>;
-  std::vector<size_t> words;
-
-  std::vector<Count> weights;
+  auto& s = local_scratch();
+  auto& words = s.words; words.clear();
+  auto& weights = s.weights; weights.clear();
   for (size_t i = 0; i < counts.size(); ++i) {
     if (counts[i] == 0) continue;
     weights.push_back({counts[i], words.size()});
@@ -60,77 +78,87 @@ huffman_t length_limited_huffman(std::span<const size_t> counts, const size_t li
   std::sort(weights.begin(), weights.end());
   const size_t num_codes = words.size();
 
-  std::vector<node> nodes;
+  auto& nodes = s.nodes; nodes.clear();
   size_t node_id = num_codes;
 
-  std::vector<Count> items;
+  // Package-merge. Each level merges the weights with the packages of the previous level
+  // (as std::merge would) and pairs them up on the fly.
+  auto& items = s.items; items.clear();
+  auto& next_items = s.next_items;
   for (size_t lv = limit; lv > 0; --lv) {
-    std::vector<Count> merged_items;
-    std::merge(weights.begin(), weights.end(), items.begin(), items.end(), std::back_inserter(merged_items));
-    items.clear();
-    for (size_t i = 0; i + 1 < merged_items.size(); i += 2) {
-      const auto& left = merged_items[i + 0];
-      const auto& right = merged_items[i + 1];
-      items.emplace_back(left.first + right.first, node_id++);
-      nodes.emplace_back(left.second, right.second);
+    next_items.clear();
+    size_t wi = 0, ii = 0;
+    const auto pop = [&] {
+      if (ii == items.size() || (wi < weights.size() && !(items[ii] < weights[wi]))) return weights[wi++];
+      return items[ii++];
+    };
+    for (size_t i = 0, total = weights.size() + items.size(); i + 1 < total; i += 2) {
+      const auto left = pop();
+      const auto right = pop();
+      next_items.emplace_back(left.first + right.first, node_id++);
+      nodes.push_back({left.second, right.second});
     }
+    std::swap(items, next_items);
   }
 
-  std::vector<size_t> depth(num_codes, 0);
-  std::function<void(size_t)> traverse = [&](size_t id) {
-    if (id < num_codes) {
-      depth[id] += 1;
-    } else {
-      id -= num_codes;
-      traverse(nodes[id].left);
-      traverse(nodes[id].right);
-    }
-  };
-
+  // The depth of a leaf is the number of times it occurs in the chosen packages.
+  // Children have smaller ids than their parents, so one pass from the top counts them.
   assert(items.size() == words.size() - 1);
-  for (size_t i = 0; i < items.size(); ++i) traverse(items[i].second);
+  auto& depth = s.depth; depth.assign(node_id, 0);
+  for (const auto& item : items) depth[item.second] += 1;
+  for (size_t id = node_id; id-- > num_codes; ) {
+    const auto& nd = nodes[id - num_codes];
+    depth[nd.left] += depth[id];
+    depth[nd.right] += depth[id];
+  }
 
-  std::vector<Leaf> leaves(words.size());
+  auto& leaves = s.leaves; leaves.resize(words.size());
   for (size_t i = 0; i < words.size(); ++i) leaves[i] = Leaf(depth[i], words[i]);
 
   return create_codewords(counts.size(), leaves, zero_to_one);
 }
 
 huffman_t huffman(std::span<const size_t> counts, bool zero_to_one) {
-  using Count = std::pair<ptrdiff_t, size_t>;
-  std::priority_queue<Count, std::vector<Count>, std::greater<Count> > pqueue;
-
-  std::vector<size_t> words;
+  auto& s = local_scratch();
+  auto& words = s.words; words.clear();
+  auto& weights = s.weights; weights.clear();
   for (size_t i = 0; i < counts.size(); ++i) {
     if (counts[i] == 0) continue;
-    pqueue.push(Count(counts[i], words.size()));
+    weights.push_back({counts[i], words.size()});
     words.push_back(i);
   }
   if (words.size() == 0) return huffman_t();
 
   const size_t num_codes = words.size();
-  std::vector<node> nodes;
+  auto& nodes = s.nodes; nodes.clear();
+
+  // The sorted leaves and the internal nodes (created with non-decreasing weights and increasing ids)
+  // form two sorted queues, so popping the smaller front gives the order of a priority queue.
+  std::sort(weights.begin(), weights.end());
+  auto& internal = s.items; internal.clear();
+  size_t wi = 0, ii = 0;
+  const auto pop = [&] {
+    if (ii == internal.size() || (wi < weights.size() && weights[wi] < internal[ii])) return weights[wi++];
+    return internal[ii++];
+  };
 
   size_t node_id = num_codes;
-  while (pqueue.size() >= 2) {
-    const auto left = pqueue.top(); pqueue.pop();
-    const auto right = pqueue.top(); pqueue.pop();
+  for (; node_id < 2 * num_codes - 1; ++node_id) {
+    const auto left = pop();
+    const auto right = pop();
     nodes.push_back({left.second, right.second});
-    pqueue.push(Count(left.first + right.first, node_id++));
+    internal.emplace_back(left.first + right.first, node_id);
   }
 
-  // create a huffman tree
-  std::vector<Leaf> leaves;
-  std::function<void(size_t, size_t)> traverse = [&](size_t id, ptrdiff_t depth) {
-    if (id < num_codes) {
-      leaves.emplace_back(depth, words[id]);
-    } else {
-      id -= num_codes;
-      traverse(nodes[id].left, depth + 1);
-      traverse(nodes[id].right, depth + 1);
-    }
-  };
-  traverse(node_id - 1, 0);
+  // Children have smaller ids than their parents.
+  auto& depth = s.depth; depth.assign(node_id, 0);
+  for (size_t id = node_id; id-- > num_codes; ) {
+    const auto& nd = nodes[id - num_codes];
+    depth[nd.left] = depth[nd.right] = depth[id] + 1;
+  }
+
+  auto& leaves = s.leaves; leaves.resize(num_codes);
+  for (size_t i = 0; i < num_codes; ++i) leaves[i] = Leaf(depth[i], words[i]);
 
   return create_codewords(counts.size(), leaves, zero_to_one);
 }
@@ -39,7 +39,7 @@ std::vector<uint8_t> kamen_rider_sd_comp(std::span<const uint8_t> input) {
     0x92, 0xcb, 0xb9, 0xb0, 0xbc, 0xaf, 0xbb, 0xa8, 0xa6, 0xa4, 0xb5, 0xad, 0xb7, 0xca, 0xa9
   }), 2);
 
-  lz_helper lz_helper(input);
+  level_lz_helper lz_helper(input, false, 2, 6);
   std::vector<encode::lz_data> lzs_memo(input.size()), lz_memo(input.size());
 
   for (size_t i = 0; i < input.size(); ++i) {
@@ -47,6 +47,7 @@ std::vector<uint8_t> wild_guns_comp_2(std::span<const uint8_t> input) {
 
   using namespace data_type;
   writer ret(3);
+  ret.reserve(dp.optimal_cost() + 3 + (input.size() & 1));
   if (input.size() & 1) ret.write<d8>(input.back());
 
   size_t adr = 0;
@@ -64,7 +65,7 @@ std::vector<uint8_t> wild_guns_comp_2(std::span<const uint8_t> input) {
   write16(ret.out, 1, input.size());
   assert(adr == input.size() / 2 * 2);
   assert(dp.optimal_cost() + 3 + (input.size() & 1) == ret.size());
-  return ret.out;
+  return std::move(ret.out);
 }
 
 } // namespace
@@ -1,5 +1,6 @@
 #include "algorithm.hpp"
 #include "encode.hpp"
+#include "refine.hpp"
 #include "utility.hpp"
 #include "writer.hpp"
 
@@ -14,7 +15,7 @@ std::vector<uint8_t> knights_of_the_round_comp(std::span<const uint8_t> in) {
   std::vector<uint8_t> input(in.size() + pad, 0x20);
   std::ranges::copy(in, input.begin() + pad);
 
-  lz_helper lz_helper(input);
+  level_lz_helper lz_helper(input, false, 2, 3 + 0x0f);
   std::vector<std::array<encode::lz_data, 2>> lz_memo(input.size());
   for (size_t i = 0; i < pad; ++i) lz_helper.add_element(i);
   for (size_t i = pad; i < input.size(); ++i) {
@@ -32,8 +33,10 @@ std::vector<uint8_t> knights_of_the_round_comp(std::span<const uint8_t> in) {
   std::vector<uint8_t> cands;
   for (const auto v : utility::k_most<uint8_t, cand_size[0]>(freq)) cands.push_back(v);
 
-  for (size_t iter = 0; iter < iter_total; ++iter) {
-    solver<tag> dp(input.size());
+  solver<tag> dp(input.size());
+  refinement refine;
+  for (size_t iter = 0, next = 1; iter < iter_total && refine.next(); iter = next) {
+    if (iter > 0) dp.reset();
     auto c0 = dp.c<0>(3 + 0x0f);
     auto c8 = dp.c<8>(0x10 + 0xff);
 
@@ -65,7 +68,8 @@ std::vector<uint8_t> knights_of_the_round_comp(std::span<const uint8_t> in) {
         adr += cmd.len;
       }
       assert(adr == input.size());
-      const size_t nsize = cand_size[iter + 1];
+      next = refine.next_step(iter, iter_total);
+      const size_t nsize = cand_size[next];
       std::partial_sort(cands.begin() + iter, cands.begin() + nsize, cands.end(),
         [&](size_t a, size_t b) { return counter[a] > counter[b]; });
       cands.resize(nsize);
@@ -42,15 +42,17 @@ void koei_comp_core(std::span<const uint8_t> input,
     {0x0081, 14, 0b0000000'0000000}
   }, 0x00ff);
 
-  lz_helper lz_helper(input, true);
-  solver<tag> dp(input.size());
+  level_lz_helper lz_helper(input, true, len_tab.front().min, len_tab.back().max);
+  solver<tag, size_t, uint16_t> dp(input.size());
   auto c0 = dp.template c<0>(len_tab.back().max);
 
+  std::array<encode::lz_data, ofs_tab.size()> lz_memo;
   for (size_t i = input.size(); i--; ) {
     lz_helper.reset(i);
     dp.update(i, 1, 9, {uncomp, 0, 0});
+    lz_helper.find_all(i, ofs_tab, len_tab.front().min, lz_memo);
     dp.update_matrix(i, ofs_tab, len_tab, c0, 1,
-      [&](size_t oi) { return lz_helper.find(i, ofs_tab[oi].max, len_tab.front().min); },
+      [&](size_t oi) { return lz_memo[oi]; },
       [&](size_t oi, size_t li) -> tag { return {lz, oi, li}; }
     );
     c0.update(i);
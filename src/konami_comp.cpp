@@ -11,10 +11,20 @@ std::vector<uint8_t> konami_comp_core(std::span<const uint8_t> in,
     const size_t version, const bool reorder) {
   enum tag { uncomp, rle0, rle0l, rle, lz, common16 };
   static constexpr size_t pad = 0x21;
+  // With `reorder`, the bytes of each 16-byte row are deinterleaved (even ones first) on the copy.
   std::vector<uint8_t> input(in.size() + pad);
-  std::ranges::copy(in, input.begin() + pad);
+  if (!reorder) {
+    std::ranges::copy(in, input.begin() + pad);
+  } else {
+    for (size_t i = 0; i < in.size(); i += 0x10) {
+      for (size_t j = 0; j < 8; ++j) {
+        input[pad + i + j + 0] = in[i + 2 * j + 0];
+        input[pad + i + j + 8] = in[i + 2 * j + 1];
+      }
+    }
+  }
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 2, 0x21);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(0x101);
   auto c1 = dp.c<1>(31);
@@ -43,6 +53,7 @@ std::vector<uint8_t> konami_comp_core(std::span<const uint8_t> in,
 
   using namespace data_type;
   writer ret(2);
+  ret.reserve(dp.optimal_cost(pad) + 2);
   size_t adr = pad;
   for (const auto& cmd : dp.optimal_path(pad)) {
     const size_t d = (cmd.lz_ofs() - pad - 0x21) & 0x03ff;
@@ -65,7 +76,7 @@ std::vector<uint8_t> konami_comp_core(std::span<const uint8_t> in,
   }
   assert(dp.optimal_cost(pad) + 2 == ret.size());
   assert(adr - pad == in.size());
-  return ret.out;
+  return std::move(ret.out);
 }
 
 } // namespace
@@ -83,14 +94,7 @@ std::vector<uint8_t> konami_comp_2(std::span<const uint8_t> input) {
 std::vector<uint8_t> konami_comp_2_r(std::span<const uint8_t> input) {
   check_divisibility(input.size(), 0x10);
   check_size(input.size(), 0, 0x8000);
-  std::vector<uint8_t> reordered(input.size());
-  for (size_t i = 0; i < input.size(); i += 0x10) {
-    for (size_t j = 0; j < 8; ++j) {
-      reordered[i + j + 0] = input[i + 2 * j + 0];
-      reordered[i + j + 8] = input[i + 2 * j + 1];
-    }
-  }
-  return konami_comp_core(reordered, 1, true);
+  return konami_comp_core(input, 1, true);
 }
 
 } // namespace sfc_comp
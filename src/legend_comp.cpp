@@ -18,7 +18,7 @@ std::vector<uint8_t> legend_comp(std::span<const uint8_t> input) {
     {0x013, 11, 0b000'00000000}
   }, 0x100); // cf. $82:8868
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 2, lens.back().max);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(lens.back().max);
 
@@ -20,10 +20,10 @@ std::vector<uint8_t> lennus_2_comp(std::span<const uint8_t> in) {
   std::vector<uint8_t> input(in.size() + pad, 0);
   std::ranges::copy(in, input.begin() + pad);
 
-  std::vector<uint8_t> best;
-
-  for (size_t comp_type = 0x5059; comp_type <= 0x5159; comp_type += 0x100) {
-    lz_helper lz_helper(input, true);
+  const auto index = level_lz_helper<>::analyze(input);
+  return parallel::best_of(2, input.size(), [&](size_t k) {
+    const size_t comp_type = 0x5059 + 0x100 * k;
+    level_lz_helper lz_helper(input, index, true, 2, lz_lens.back());
     solver<tag> dp(input.size());
     auto c0 = dp.c<0>(lz_lens.back());
 
@@ -70,9 +70,8 @@ std::vector<uint8_t> lennus_2_comp(std::span<const uint8_t> in) {
     write24(ret.out, 5, ret.size() - 8);
     assert(adr == input.size());
     assert(dp.optimal_cost(pad) + 8 * 8 == ret.bit_length());
-    if (best.empty() || ret.size() < best.size()) best = std::move(ret.out);
-  }
-  return best;
+    return std::move(ret.out);
+  });
 }
 
 } // namespace sfc_comp
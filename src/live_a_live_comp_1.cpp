@@ -16,7 +16,7 @@ std::vector<uint8_t> live_a_live_comp_1(std::span<const uint8_t> input) {
     lzl, lzs, lz8
   };
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 4, 0x113);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(0x113); auto c1 = dp.c<1>(0xf0);
   auto c0_2 = dp.c<0, 2>(0x204); auto c1_2 = dp.c<1, 2>(0x206);
@@ -93,6 +93,7 @@ std::vector<uint8_t> live_a_live_comp_1(std::span<const uint8_t> input) {
 
   using namespace data_type;
   writer ret; ret.write<d8>(1);
+  ret.reserve(dp.optimal_cost() + 2);
   size_t adr = 0;
   for (const auto& cmd : dp.optimal_path()) {
     switch (cmd.type) {
@@ -162,7 +163,7 @@ std::vector<uint8_t> live_a_live_comp_1(std::span<const uint8_t> input) {
   ret.write<d8>(0xff);
   assert(dp.optimal_cost() + 2 == ret.size());
   assert(adr == input.size());
-  return ret.out;
+  return std::move(ret.out);
 }
 
 } // namespace sfc_comp
@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <list>
+#include <mutex>
+
+#include "lz.hpp"
+#include "sfc_comp.hpp"
+
+namespace sfc_comp {
+
+namespace {
+
+struct cache_entry {
+  std::vector<uint8_t> input;
+  std::shared_ptr<const match_index<uint8_t>> index;
+};
+
+std::mutex cache_mutex;
+size_t cache_capacity = 0;
+std::list<cache_entry> cache; // The most recently used one comes first.
+
+} // namespace
+
+namespace analysis {
+
+scope::scope(size_t capacity) {
+  std::lock_guard lock(cache_mutex);
+  prev_capacity = cache_capacity;
+  cache_capacity = capacity;
+  while (cache.size() > cache_capacity) cache.pop_back();
+}
+
+scope::~scope() {
+  std::lock_guard lock(cache_mutex);
+  cache_capacity = prev_capacity;
+  while (cache.size() > cache_capacity) cache.pop_back();
+}
+
+} // namespace analysis
+
+namespace detail {
+
+std::shared_ptr<const match_index<uint8_t>> shared_match_index(std::span<const uint8_t> input) {
+  {
+    std::lock_guard lock(cache_mutex);
+    if (cache_capacity == 0) return std::make_shared<const match_index<uint8_t>>(input);
+    for (auto it = cache.begin(); it != cache.end(); ++it) {
+      if (std::ranges::equal(it->input, input)) {
+        cache.splice(cache.begin(), cache, it);
+        return cache.front().index;
+      }
+    }
+  }
+  auto index = std::make_shared<const match_index<uint8_t>>(input);
+  std::lock_guard lock(cache_mutex);
+  if (cache_capacity > 0) {
+    cache.push_front({std::vector<uint8_t>(input.begin(), input.end()), index});
+    while (cache.size() > cache_capacity) cache.pop_back();
+  }
+  return index;
+}
+
+} // namespace detail
+
+} // namespace sfc_comp
@@ -1,9 +1,18 @@
 #pragma once
 
+#include <array>
+#include <cassert>
+#include <iterator>
 #include <limits>
+#include <memory>
+#include <optional>
 #include <span>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
 
 #include "data_structure.hpp"
+#include "options.hpp"
 
 namespace sfc_comp {
 
@@ -21,6 +30,32 @@ struct range_min {
   static constexpr T op(const value_type& l, const value_type& r) { return std::min<T>(l, r); }
 };
 
+struct vrange {
+  size_t min;
+  size_t max;
+  size_t bitlen;
+  uint64_t val;
+  uint64_t mask = -1;
+};
+
+struct vrange_min {
+  size_t min;
+  size_t bitlen;
+  uint64_t val;
+  uint64_t mask = -1;
+};
+
+template <size_t N>
+constexpr std::array<vrange, N> to_vranges(vrange_min (&&a)[N], size_t max_len) {
+  return create_array<vrange, N>([&](size_t i) {
+    return vrange(a[i].min, (i + 1 == N) ? max_len : a[i + 1].min - 1, a[i].bitlen, a[i].val, a[i].mask);
+  });
+}
+
+// The segment tree layout of the lcp and offset trees of the lz helpers.
+template <typename T>
+using lz_segment_tree = wide_segment_tree<T>;
+
 namespace encode {
 
 struct lz_data {
@@ -34,13 +69,19 @@ struct lz_data {
 
 namespace lz {
 
+// Unsigned offset nodes store (position + 1) so that 0 can mean "none".
+template <typename S>
+inline constexpr ptrdiff_t offset_bias = std::is_unsigned_v<S> ? 1 : 0;
+
 template <typename U, typename S = std::make_signed_t<U>>
 requires std::integral<U>
 encode::lz_data find_left(size_t adr, size_t i, size_t d, size_t min_len,
     std::span<const U> lcp_node, std::span<const S> ofs_node) {
   if (i == 0) return {};
   const size_t width = lcp_node.size() / 2;
-  const auto found = [&](size_t k) { return ofs_node[k] + ptrdiff_t(d) >= ptrdiff_t(adr); };
+  constexpr ptrdiff_t bias = offset_bias<S>;
+  if constexpr (bias > 0) d = std::min(d, adr);
+  const auto found = [&](size_t k) { return ofs_node[k] - bias + ptrdiff_t(d) >= ptrdiff_t(adr); };
   U lcp = std::numeric_limits<U>::max();
   const auto quit = [&](size_t k) { return lcp_node[k] < lcp && (lcp = lcp_node[k]) < min_len; };
 
@@ -61,7 +102,7 @@ encode::lz_data find_left(size_t adr, size_t i, size_t d, size_t min_len,
     }
   }
   if (quit(k)) return {};
-  return {size_t(ofs_node[lo + width]), lcp};
+  return {size_t(ofs_node[lo + width] - bias), lcp};
 }
 
 template <typename U, typename S = std::make_signed_t<U>>
@@ -69,7 +110,9 @@ requires std::integral<U>
 encode::lz_data find_right(size_t adr, size_t i, size_t d, size_t min_len,
     std::span<const U> lcp_node, std::span<const S> ofs_node) {
   const size_t width = lcp_node.size() / 2;
-  const auto found = [&](size_t k) { return ofs_node[k] + ptrdiff_t(d) >= ptrdiff_t(adr); };
+  constexpr ptrdiff_t bias = offset_bias<S>;
+  if constexpr (bias > 0) d = std::min(d, adr);
+  const auto found = [&](size_t k) { return ofs_node[k] - bias + ptrdiff_t(d) >= ptrdiff_t(adr); };
   U lcp = std::numeric_limits<U>::max();
   const auto quit = [&](size_t k) { return lcp_node[k] < lcp && (lcp = lcp_node[k]) < min_len; };
 
@@ -89,7 +132,7 @@ encode::lz_data find_right(size_t adr, size_t i, size_t d, size_t min_len,
       lo = mi, k = 2 * k + 1;
     }
   }
-  return {size_t(ofs_node[lo + width]), lcp};
+  return {size_t(ofs_node[lo + width] - bias), lcp};
 }
 
 template <typename U, typename S = std::make_signed_t<U>>
@@ -101,23 +144,179 @@ encode::lz_data find(size_t adr, size_t rank, size_t max_dist, size_t min_len,
   return left.len >= right.len ? left : right; // [TODO] choose the close one.
 }
 
-template <typename U, typename S = std::make_signed_t<U>>
+template <typename U, typename S>
 requires std::integral<U>
-encode::lz_data find_closest(size_t adr, size_t rank, size_t max_dist, size_t min_len, size_t max_len,
+encode::lz_data find(size_t adr, size_t rank, size_t max_dist, size_t min_len,
     const segment_tree<range_min<U>>& lcp, const segment_tree<range_max<S>>& seg) {
-  auto ret = find(adr, rank, max_dist, min_len, lcp.nodes(), seg.nodes());
-  if (ret.len > 0) {
-    if (ret.len > max_len) ret.len = max_len;
-    const auto r = lcp.find_range(rank, [&](size_t len) { return len >= ret.len; });
-    ret.ofs = seg.fold(r.first, r.second + 1);
+  return find(adr, rank, max_dist, min_len, lcp.nodes(), seg.nodes());
+}
+
+namespace detail {
+
+// Walks from rank i towards rank 0 on wide_segment_tree and returns the nearest rank j < i whose
+// position is within `d` of `adr`, or -1. `lcp` is lowered to the minimum lcp on the way and
+// -1 is also returned once it falls below `min_len`.
+template <typename U, typename S, size_t Arity>
+requires std::integral<U>
+ptrdiff_t walk_left(size_t adr, size_t i, size_t d, size_t min_len, U& lcp,
+    const wide_segment_tree<range_min<U>, Arity>& lcp_tree,
+    const wide_segment_tree<range_max<S>, Arity>& ofs_tree) {
+  constexpr ptrdiff_t bias = offset_bias<S>;
+  if constexpr (bias > 0) d = std::min(d, adr);
+  const auto found = [&](S ofs) { return ofs - bias + ptrdiff_t(d) >= ptrdiff_t(adr); };
+  const auto quit = [&](U v) { return v < lcp && (lcp = v) < min_len; };
+
+  size_t l = 0, k = i;
+  for (;; ++l, k /= Arity) {
+    const auto lcp_nodes = lcp_tree.level(l), ofs_nodes = ofs_tree.level(l);
+    const size_t b = k - k % Arity;
+    for (; k > b && !found(ofs_nodes[k - 1]); --k) {
+      if (quit(lcp_nodes[k - 1])) return -1;
+    }
+    if (k > b) { --k; break; }
+    if (b == 0) return -1;
   }
-  return ret;
+  for (; l > 0; --l) {
+    const auto lcp_nodes = lcp_tree.level(l - 1), ofs_nodes = ofs_tree.level(l - 1);
+    for (k = k * Arity + Arity - 1; !found(ofs_nodes[k]); --k) {
+      if (quit(lcp_nodes[k])) return -1;
+    }
+  }
+  if (quit(lcp_tree[k])) return -1;
+  return k;
 }
 
-template <typename U, typename Elem>
+// The same as walk_left towards the last rank, starting at rank i itself.
+template <typename U, typename S, size_t Arity>
+requires std::integral<U>
+ptrdiff_t walk_right(size_t adr, size_t i, size_t d, size_t min_len, U& lcp,
+    const wide_segment_tree<range_min<U>, Arity>& lcp_tree,
+    const wide_segment_tree<range_max<S>, Arity>& ofs_tree) {
+  constexpr ptrdiff_t bias = offset_bias<S>;
+  if constexpr (bias > 0) d = std::min(d, adr);
+  const auto found = [&](S ofs) { return ofs - bias + ptrdiff_t(d) >= ptrdiff_t(adr); };
+  const auto quit = [&](U v) { return v < lcp && (lcp = v) < min_len; };
+
+  size_t l = 0, k = i;
+  for (;; ++l, k /= Arity) {
+    const auto lcp_nodes = lcp_tree.level(l), ofs_nodes = ofs_tree.level(l);
+    if (k == ofs_nodes.size()) return -1;
+    const size_t e = k - k % Arity + Arity;
+    for (; k < e && !found(ofs_nodes[k]); ++k) {
+      if (quit(lcp_nodes[k])) return -1;
+    }
+    if (k < e) break;
+    if (l + 1 == ofs_tree.levels()) return -1;
+  }
+  for (; l > 0; --l) {
+    const auto lcp_nodes = lcp_tree.level(l - 1), ofs_nodes = ofs_tree.level(l - 1);
+    for (k = k * Arity; !found(ofs_nodes[k]); ++k) {
+      if (quit(lcp_nodes[k])) return -1;
+    }
+  }
+  return k;
+}
+
+} // namespace detail
+
+// The same queries on wide_segment_tree, which scan the siblings of a node instead of
+// visiting them one level at a time. `lcp_tree` and `ofs_tree` must have the same size.
+template <typename U, typename S, size_t Arity>
+requires std::integral<U>
+encode::lz_data find_left(size_t adr, size_t i, size_t d, size_t min_len,
+    const wide_segment_tree<range_min<U>, Arity>& lcp_tree,
+    const wide_segment_tree<range_max<S>, Arity>& ofs_tree) {
+  U lcp = std::numeric_limits<U>::max();
+  const ptrdiff_t k = detail::walk_left(adr, i, d, min_len, lcp, lcp_tree, ofs_tree);
+  if (k < 0) return {};
+  return {size_t(ofs_tree[k] - offset_bias<S>), lcp};
+}
+
+template <typename U, typename S, size_t Arity>
+requires std::integral<U>
+encode::lz_data find_right(size_t adr, size_t i, size_t d, size_t min_len,
+    const wide_segment_tree<range_min<U>, Arity>& lcp_tree,
+    const wide_segment_tree<range_max<S>, Arity>& ofs_tree) {
+  U lcp = std::numeric_limits<U>::max();
+  const ptrdiff_t k = detail::walk_right(adr, i, d, min_len, lcp, lcp_tree, ofs_tree);
+  if (k < 0) return {};
+  return {size_t(ofs_tree[k] - offset_bias<S>), lcp};
+}
+
+template <typename U, typename S, size_t Arity>
+requires std::integral<U>
+encode::lz_data find(size_t adr, size_t rank, size_t max_dist, size_t min_len,
+    const wide_segment_tree<range_min<U>, Arity>& lcp, const wide_segment_tree<range_max<S>, Arity>& seg) {
+  const auto left = find_left(adr, rank, max_dist, min_len, lcp, seg);
+  const auto right = find_right(adr, rank, max_dist, min_len, lcp, seg);
+  return left.len >= right.len ? left : right; // [TODO] choose the close one.
+}
+
+// Sets dest[k] to find(adr, rank, max_dist(k), min_len, lcp_tree, ofs_tree) for every k,
+// where max_dist(k) must be non-decreasing.
+// Each side is walked only once: after a match is found, the walk resumes from it with the
+// largest limit the match does not satisfy, so it only stops at the matches on the
+// (distance, length) Pareto frontier.
+template <typename U, typename S, size_t Arity, typename MaxDist>
+requires std::integral<U> && std::convertible_to<std::invoke_result_t<MaxDist, size_t>, size_t>
+void find_frontier(size_t adr, size_t rank, MaxDist&& max_dist, size_t min_len,
+    const wide_segment_tree<range_min<U>, Arity>& lcp_tree,
+    const wide_segment_tree<range_max<S>, Arity>& ofs_tree, std::span<encode::lz_data> dest) {
+  constexpr ptrdiff_t bias = offset_bias<S>;
+  const auto within = [&](size_t pos, size_t d) {
+    if constexpr (bias > 0) d = std::min(d, adr);
+    return ptrdiff_t(pos) + ptrdiff_t(d) >= ptrdiff_t(adr);
+  };
+
+  ptrdiff_t k = dest.size() - 1;
+  U lcp = std::numeric_limits<U>::max();
+  for (size_t i = rank; k >= 0; ) {
+    const ptrdiff_t j = detail::walk_left(adr, i, max_dist(k), min_len, lcp, lcp_tree, ofs_tree);
+    if (j < 0) break;
+    const size_t pos = ofs_tree[j] - bias;
+    for (; k >= 0 && within(pos, max_dist(k)); --k) dest[k] = {pos, lcp};
+    i = j;
+  }
+  for (; k >= 0; --k) dest[k] = {};
+
+  k = dest.size() - 1;
+  lcp = std::numeric_limits<U>::max();
+  for (size_t i = rank; k >= 0; ) {
+    const ptrdiff_t j = detail::walk_right(adr, i, max_dist(k), min_len, lcp, lcp_tree, ofs_tree);
+    if (j < 0) break;
+    const size_t pos = ofs_tree[j] - bias;
+    for (; k >= 0 && within(pos, max_dist(k)); --k) {
+      if (lcp > dest[k].len) dest[k] = {pos, lcp};
+    }
+    // Matches beyond rank j also share lcp[j].
+    if ((lcp = std::min<U>(lcp, lcp_tree[j])) < min_len) break;
+    i = j + 1;
+  }
+}
+
+// Replaces the offset of `res` with the closest position that has a match of
+// min(res.len, max_len) bytes.
+template <typename LcpTree, typename OffsetTree>
+encode::lz_data to_closest(encode::lz_data res, size_t rank, size_t max_len,
+    const LcpTree& lcp, const OffsetTree& seg) {
+  if (res.len > 0) {
+    if (res.len > max_len) res.len = max_len;
+    const auto r = lcp.find_range(rank, [&](size_t len) { return len >= res.len; });
+    res.ofs = seg.fold(r.first, r.second + 1) - offset_bias<typename OffsetTree::value_type>;
+  }
+  return res;
+}
+
+template <typename LcpTree, typename OffsetTree>
+encode::lz_data find_closest(size_t adr, size_t rank, size_t max_dist, size_t min_len, size_t max_len,
+    const LcpTree& lcp, const OffsetTree& seg) {
+  return to_closest(find(adr, rank, max_dist, min_len, lcp, seg), rank, max_len, lcp, seg);
+}
+
+template <typename U>
 requires std::integral<U>
 encode::lz_data find(size_t i, size_t j, size_t rank, const wavelet_matrix<U>& wm,
-    const segment_tree<range_min<U>>& lcp, const suffix_array<Elem, U>& sa) {
+    const lz_segment_tree<range_min<U>>& lcp, std::span<const U> sa) {
   const auto k = wm.count_lt(i, j, rank);
   encode::lz_data ret = {};
   if (k > 0) {
@@ -155,58 +354,346 @@ encode::lz_data find_non_overlapping(size_t adr_l, size_t adr, Func&& find_lz, e
   return ret;
 }
 
+// Answers find(adr_l, adr_r, rank, ...) of the wavelet matrix for any adr_r <= adr without it.
+// The nearest rank below `rank` whose position is in [adr_l, adr_r) is the first entry before
+// adr_r of the chain: the nearest rank below `rank` in [adr_l, adr), then the nearest rank below
+// it in [adr_l, (its position)), and so on (the same for ranks above `rank`).
+// The chains are walked lazily on a tree holding every position, up to Capacity entries (and
+// 4 * Capacity steps); `find` returns nullopt if a query needs more than that.
+template <typename U, typename S, size_t Arity, size_t Capacity = 32>
+requires std::integral<U>
+class nearest_rank_chains {
+ public:
+  nearest_rank_chains(size_t adr, size_t adr_l, size_t rank,
+      const wide_segment_tree<range_min<U>, Arity>& lcp_tree,
+      const wide_segment_tree<range_max<S>, Arity>& ofs_tree)
+      : adr(adr), dist(adr - adr_l), lcp_tree(lcp_tree), ofs_tree(ofs_tree) {
+    left.next = rank;
+    right.next = rank + 1;
+    right.lcp = lcp_tree[rank];
+    right.done = right.next >= lcp_tree.size() || right.lcp < 1;
+  }
+
+  std::optional<encode::lz_data> find(size_t adr_r) {
+    const auto l = first_before(left, adr_r, [&] { return extend_left(); });
+    const auto r = first_before(right, adr_r, [&] { return extend_right(); });
+    if (!l || !r) return std::nullopt;
+    encode::lz_data ret = {};
+    if (l->len > ret.len) ret = *l;
+    if (r->len > ret.len) ret = *r;
+    return ret;
+  }
+
+ private:
+  struct chain {
+    std::array<encode::lz_data, Capacity> items;
+    size_t size = 0;
+    size_t steps = 0;
+    size_t next;
+    U lcp = std::numeric_limits<U>::max();
+    bool done = false;
+  };
+
+  template <typename Extend>
+  std::optional<encode::lz_data> first_before(chain& c, size_t adr_r, Extend&& extend) {
+    for (size_t i = 0; ; extend()) {
+      for (; i < c.size; ++i) {
+        if (c.items[i].ofs < adr_r) return c.items[i];
+      }
+      if (c.done) return encode::lz_data{};
+      if (c.size == Capacity || c.steps++ == 4 * Capacity) return std::nullopt;
+    }
+  }
+
+  // Positions at or after the last entry (including those after adr) are skipped.
+  void push(chain& c, size_t pos) {
+    if (c.size == 0 ? pos < adr : pos < c.items[c.size - 1].ofs) c.items[c.size++] = {pos, c.lcp};
+  }
+
+  void extend_left() {
+    const ptrdiff_t j = detail::walk_left(adr, left.next, dist, 1, left.lcp, lcp_tree, ofs_tree);
+    if (j < 0) { left.done = true; return; }
+    push(left, ofs_tree[j] - offset_bias<S>);
+    left.next = j;
+  }
+
+  void extend_right() {
+    const ptrdiff_t j = detail::walk_right(adr, right.next, dist, 1, right.lcp, lcp_tree, ofs_tree);
+    if (j < 0) { right.done = true; return; }
+    push(right, ofs_tree[j] - offset_bias<S>);
+    right.next = j + 1;
+    if ((right.lcp = std::min<U>(right.lcp, lcp_tree[j])) < 1) right.done = true;
+  }
+
+  const size_t adr;
+  const size_t dist;
+  const wide_segment_tree<range_min<U>, Arity>& lcp_tree;
+  const wide_segment_tree<range_max<S>, Arity>& ofs_tree;
+  chain left, right;
+};
+
 } // namespace lz
 
 } // namespace encode
 
-template <typename U = uint32_t>
+// The suffix array, rank (inverse suffix array) and lcp of one input, stored with IndexType.
+template <typename IndexType>
+requires std::unsigned_integral<IndexType>
+struct match_arrays {
+  using index_type = IndexType;
+
+  template <typename ElementType>
+  match_arrays(std::span<const ElementType> input) {
+    auto sa = suffix_array<ElementType, index_type>(input);
+    auto [lcp, rank] = sa.lcp_rank();
+    this->lcp = lz_segment_tree<range_min<index_type>>(lcp);
+    this->rank = std::move(rank);
+    this->sa = std::move(sa).release();
+  }
+
+  std::vector<index_type> sa;
+  std::vector<index_type> rank;
+  lz_segment_tree<range_min<index_type>> lcp;
+};
+
+// The match index of one input. It is immutable once built, so lz helpers on the same input can share it.
+// In compact mode (SFC_COMP_COMPACT), inputs of at most `compact_max_size` symbols use 16-bit indices.
+template <typename ElementType = uint8_t, typename U = uint32_t>
 requires std::unsigned_integral<U>
-class lz_helper {
-public:
+class match_index {
+ public:
+  using element_type = ElementType;
+  using index_type = U;
+  using compact_index_type = uint16_t;
+
+#ifdef SFC_COMP_COMPACT
+  static constexpr bool compact_enabled = sizeof(compact_index_type) < sizeof(index_type);
+#else
+  static constexpr bool compact_enabled = false;
+#endif
+  // (position + 1) has to fit in compact_index_type.
+  static constexpr size_t compact_max_size = std::numeric_limits<compact_index_type>::max();
+
+  match_index(std::span<const element_type> input) : n(input.size()) {
+    if constexpr (compact_enabled) {
+      if (n <= compact_max_size) {
+        small.emplace(input);
+        return;
+      }
+    }
+    large.emplace(input);
+  }
+
+  static std::shared_ptr<const match_index> create(std::span<const element_type> input);
+
+  size_t size() const { return n; }
+  bool compact() const { return compact_enabled && small.has_value(); }
+
+  // Calls `func(arrays)` with the arrays of the index width in use.
+  template <typename Func>
+  decltype(auto) visit(Func&& func) const {
+    if constexpr (compact_enabled) {
+      if (small) return func(*small);
+    }
+    return func(*large);
+  }
+
+ private:
+  size_t n;
+  std::optional<match_arrays<compact_index_type>> small;
+  std::optional<match_arrays<index_type>> large;
+};
+
+namespace detail {
+
+// Returns the index cached by an active `analysis::scope` if any.
+std::shared_ptr<const match_index<uint8_t>> shared_match_index(std::span<const uint8_t> input);
+
+} // namespace detail
+
+template <typename ElementType, typename U>
+requires std::unsigned_integral<U>
+std::shared_ptr<const match_index<ElementType, U>> match_index<ElementType, U>::create(
+    std::span<const element_type> input) {
+  if constexpr (std::is_same_v<match_index, match_index<uint8_t>>) {
+    return detail::shared_match_index(input);
+  } else {
+    return std::make_shared<const match_index>(input);
+  }
+}
+
+// A range-max tree of positions indexed by rank.
+// 16-bit trees store (position + 1) since positions can reach 0xfffe.
+template <typename IndexType>
+requires std::unsigned_integral<IndexType>
+class offset_tree : public lz_segment_tree<range_max<std::conditional_t<
+    (sizeof(IndexType) < sizeof(uint32_t)), IndexType, std::make_signed_t<IndexType>>>> {
+ public:
+  using offset_type = std::conditional_t<
+    (sizeof(IndexType) < sizeof(uint32_t)), IndexType, std::make_signed_t<IndexType>>;
+  static constexpr ptrdiff_t bias = encode::lz::offset_bias<offset_type>;
+
+  offset_tree() = default;
+  offset_tree(size_t n) : lz_segment_tree<range_max<offset_type>>(n) {}
+
+  // `func(rank)` returns the position of the suffix or -1 if it should not be found.
+  template <typename Func>
+  requires std::convertible_to<std::invoke_result_t<Func, size_t>, ptrdiff_t>
+  void init_positions(Func&& func) {
+    this->init([&](size_t i) -> offset_type {
+      const ptrdiff_t pos = func(i);
+      return (pos < 0) ? this->iden : offset_type(pos + bias);
+    });
+  }
+
+  void add(size_t rank, size_t pos) {
+    this->update(rank, offset_type(pos + bias));
+  }
+};
+
+namespace detail {
+
+// Owns a shared match index and `Trees` offset trees of the index width in use.
+template <typename ElementType, typename U, size_t Trees>
+requires std::unsigned_integral<U>
+class lz_helper_base {
+ public:
   using index_type = U;
   using signed_index_type = std::make_signed_t<index_type>;
+  using match_index_type = match_index<ElementType, index_type>;
 
-  lz_helper(std::span<const uint8_t> input, bool updated = false) : n(input.size()) {
-    const auto sa = suffix_array<uint8_t>(input);
-    const auto [lcp, rank]= sa.lcp_rank();
-    this->rank = std::move(rank);
-    this->lcp = decltype(this->lcp)(lcp);
-    this->seg = decltype(seg)(n);
-    if (updated) this->seg.init([&](size_t i) { return sa[i]; });
+ protected:
+  lz_helper_base(std::shared_ptr<const match_index_type> index) : index(std::move(index)) {
+    visit([&](const auto& a, auto& segs) {
+      for (auto& seg : segs) seg = std::remove_reference_t<decltype(seg)>(a.sa.size());
+    });
+  }
+
+  // Calls `func(arrays, trees)` for the index width in use.
+  template <typename Func>
+  decltype(auto) visit(Func&& func) const {
+    return index->visit([&](const auto& a) -> decltype(auto) { return func(a, trees_for(a)); });
+  }
+
+  template <typename Func>
+  decltype(auto) visit(Func&& func) {
+    return index->visit([&](const auto& a) -> decltype(auto) { return func(a, trees_for(a)); });
+  }
+
+  std::shared_ptr<const match_index_type> index;
+
+ private:
+  template <typename T>
+  const auto& trees_for(const match_arrays<T>&) const {
+    return std::get<std::is_same_v<T, index_type> ? 1 : 0>(trees);
+  }
+
+  template <typename T>
+  auto& trees_for(const match_arrays<T>&) {
+    return std::get<std::is_same_v<T, index_type> ? 1 : 0>(trees);
+  }
+
+  std::tuple<std::array<offset_tree<typename match_index_type::compact_index_type>, Trees>,
+             std::array<offset_tree<index_type>, Trees>> trees;
+};
+
+} // namespace detail
+
+template <typename U = uint32_t>
+requires std::unsigned_integral<U>
+class lz_helper : public detail::lz_helper_base<uint8_t, U, 1> {
+public:
+  using typename detail::lz_helper_base<uint8_t, U, 1>::match_index_type;
+
+  lz_helper(std::span<const uint8_t> input, bool updated = false)
+      : lz_helper(match_index_type::create(input), updated) {}
+
+  lz_helper(std::shared_ptr<const match_index_type> index, bool updated = false)
+      : detail::lz_helper_base<uint8_t, U, 1>(std::move(index)) {
+    if (!updated) return;
+    this->visit([&](const auto& a, auto& segs) {
+      segs[0].init_positions([&](size_t i) { return a.sa[i]; });
+    });
   }
 
   encode::lz_data find(size_t pos, size_t max_dist, size_t min_len) const {
-    return encode::lz::find(pos, rank[pos], max_dist, min_len, lcp.nodes(), seg.nodes());
+    return this->visit([&](const auto& a, const auto& segs) {
+      return encode::lz::find(pos, a.rank[pos], max_dist, min_len, a.lcp, segs[0]);
+    });
   }
 
   encode::lz_data find_closest(size_t pos, size_t max_dist, size_t min_len, size_t max_len) const {
-    return encode::lz::find_closest(pos, rank[pos], max_dist, min_len, max_len, lcp, seg);
+    return this->visit([&](const auto& a, const auto& segs) {
+      return encode::lz::find_closest(pos, a.rank[pos], max_dist, min_len, max_len, a.lcp, segs[0]);
+    });
+  }
+
+  // Sets dest[k] to find(pos, offsets[k].max, min_len) for every k in one walk.
+  // The limits must be non-decreasing.
+  void find_all(size_t pos, std::span<const vrange> offsets, size_t min_len,
+      std::span<encode::lz_data> dest) const {
+    find_frontier(pos, [&](size_t k) { return offsets[k].max; }, min_len, dest.first(offsets.size()));
+  }
+
+  void find_all(size_t pos, std::span<const size_t> max_offsets, size_t min_len,
+      std::span<encode::lz_data> dest) const {
+    find_frontier(pos, [&](size_t k) { return max_offsets[k]; }, min_len, dest.first(max_offsets.size()));
+  }
+
+  // Sets dest[k] to find_closest(pos, offsets[k].max, min_len, max_len) for every k in one walk.
+  void find_all_closest(size_t pos, std::span<const vrange> offsets, size_t min_len, size_t max_len,
+      std::span<encode::lz_data> dest) const {
+    find_all(pos, offsets, min_len, dest);
+    to_closest(pos, max_len, dest.first(offsets.size()));
+  }
+
+  void find_all_closest(size_t pos, std::span<const size_t> max_offsets, size_t min_len, size_t max_len,
+      std::span<encode::lz_data> dest) const {
+    find_all(pos, max_offsets, min_len, dest);
+    to_closest(pos, max_len, dest.first(max_offsets.size()));
   }
 
   void reset(size_t i) {
-    seg.reset(rank[i]);
+    this->visit([&](const auto& a, auto& segs) { segs[0].reset(a.rank[i]); });
   }
 
   void add_element(size_t i) {
-    seg.update(rank[i], i);
+    this->visit([&](const auto& a, auto& segs) { segs[0].add(a.rank[i], i); });
   }
 
 private:
-  const size_t n;
-  std::vector<index_type> rank;
-  segment_tree<range_max<signed_index_type>> seg;
-  segment_tree<range_min<index_type>> lcp;
+  template <typename MaxDist>
+  void find_frontier(size_t pos, MaxDist&& max_dist, size_t min_len, std::span<encode::lz_data> dest) const {
+    this->visit([&](const auto& a, const auto& segs) {
+      encode::lz::find_frontier(pos, a.rank[pos], max_dist, min_len, a.lcp, segs[0], dest);
+    });
+  }
+
+  // Results of the same length have the same closest match.
+  void to_closest(size_t pos, size_t max_len, std::span<encode::lz_data> dest) const {
+    this->visit([&](const auto& a, const auto& segs) {
+      encode::lz_data prev = {}, prev_closest = {};
+      for (size_t k = dest.size(); k-- > 0; ) {
+        const auto res = dest[k];
+        if (k + 1 == dest.size() || res.len != prev.len) {
+          prev_closest = encode::lz::to_closest(res, a.rank[pos], max_len, a.lcp, segs[0]);
+        }
+        prev = res;
+        dest[k] = prev_closest;
+      }
+    });
+  }
 };
 
 template <typename U = uint32_t>
 requires std::unsigned_integral<U>
-class lz_helper_c {
+class lz_helper_c : public detail::lz_helper_base<int16_t, U, 2> {
 public:
-  using index_type = U;
-  using signed_index_type = std::make_signed_t<index_type>;
+  using typename detail::lz_helper_base<int16_t, U, 2>::match_index_type;
 
 private:
-  std::vector<int16_t> complement_appended(std::span<const uint8_t> input) const {
+  static std::vector<int16_t> complement_appended(std::span<const uint8_t> input) {
+    const size_t n = input.size();
     std::vector<int16_t> input_xor(2 * n + 1);
     for (size_t i = 0; i < n; ++i) input_xor[i] = input[i];
     input_xor[n] = -1;
@@ -215,46 +702,52 @@ private:
   }
 
 public:
-  lz_helper_c(std::span<const uint8_t> input, bool updated = false) : n(input.size()) {
-    const auto in = complement_appended(input);
-    const auto sa = suffix_array<int16_t>(in);
-    const auto [lcp, rank] = sa.lcp_rank();
-    this->rank = std::move(rank);
-    this->lcp = decltype(this->lcp)(lcp);
-    seg = decltype(seg)(rank.size());
-    if (updated) {
-      seg.init([&](size_t i) { return sa[i] < n ? sa[i] : seg.iden; });
-    }
-    seg_c = decltype(seg_c)(rank.size());
-    if (updated) {
-      seg_c.init([&](size_t i) { return sa[i] >= n + 1 ? sa[i] - (n + 1) : seg_c.iden; });
-    }
+  static std::shared_ptr<const match_index_type> analyze(std::span<const uint8_t> input) {
+    return match_index_type::create(complement_appended(input));
+  }
+
+  lz_helper_c(std::span<const uint8_t> input, bool updated = false)
+      : lz_helper_c(analyze(input), updated) {}
+
+  lz_helper_c(std::shared_ptr<const match_index_type> index, bool updated = false)
+      : detail::lz_helper_base<int16_t, U, 2>(std::move(index)), n(this->index->size() / 2) {
+    if (!updated) return;
+    this->visit([&](const auto& a, auto& segs) {
+      const auto& sa = a.sa;
+      segs[0].init_positions([&](size_t i) -> ptrdiff_t { return sa[i] < n ? ptrdiff_t(sa[i]) : -1; });
+      segs[1].init_positions([&](size_t i) -> ptrdiff_t { return sa[i] >= n + 1 ? ptrdiff_t(sa[i] - (n + 1)) : -1; });
+    });
   }
 
 public:
   encode::lz_data find(size_t pos, size_t max_dist, size_t min_len) const {
-    return encode::lz::find(pos, rank[pos], max_dist, min_len, lcp.nodes(), seg.nodes());
+    return this->visit([&](const auto& a, const auto& segs) {
+      return encode::lz::find(pos, a.rank[pos], max_dist, min_len, a.lcp, segs[0]);
+    });
   }
 
   encode::lz_data find_c(size_t pos, size_t max_dist, size_t min_len) const {
-    return encode::lz::find(pos, rank[pos], max_dist, min_len, lcp.nodes(), seg_c.nodes());
+    return this->visit([&](const auto& a, const auto& segs) {
+      return encode::lz::find(pos, a.rank[pos], max_dist, min_len, a.lcp, segs[1]);
+    });
   }
 
   void add_element(size_t i) {
-    seg.update(rank[i], signed_index_type(i));
-    seg_c.update(rank[i + n + 1], signed_index_type(i));
+    this->visit([&](const auto& a, auto& segs) {
+      segs[0].add(a.rank[i], i);
+      segs[1].add(a.rank[i + n + 1], i);
+    });
   }
 
   void reset(size_t i) {
-    seg.reset(rank[i]);
-    seg_c.reset(rank[i + n + 1]);
+    this->visit([&](const auto& a, auto& segs) {
+      segs[0].reset(a.rank[i]);
+      segs[1].reset(a.rank[i + n + 1]);
+    });
   }
 
 private:
   const size_t n;
-  std::vector<index_type> rank;
-  segment_tree<range_max<signed_index_type>> seg, seg_c;
-  segment_tree<range_min<index_type>> lcp;
 };
 
 constexpr auto bit_reversed = [] {
@@ -271,13 +764,13 @@ constexpr auto bit_reversed = [] {
 
 template <typename U = uint32_t>
 requires std::unsigned_integral<U>
-class lz_helper_kirby {
+class lz_helper_kirby : public detail::lz_helper_base<int16_t, U, 3> {
 public:
-  using index_type = U;
-  using signed_index_type = std::make_signed_t<index_type>;
+  using typename detail::lz_helper_base<int16_t, U, 3>::match_index_type;
 
 private:
-  std::vector<int16_t> hvflip_appended(std::span<const uint8_t> input) const {
+  static std::vector<int16_t> hvflip_appended(std::span<const uint8_t> input) {
+    const size_t n = input.size();
     std::vector<int16_t> ret(3 * n + 2);
     for (size_t i = 0; i < n; ++i) ret[i] = input[i];
     ret[n] = -1;
@@ -288,52 +781,64 @@ private:
   }
 
 public:
-  lz_helper_kirby(std::span<const uint8_t> input, bool updated = false) : n(input.size()) {
-    const auto in = hvflip_appended(input);
-    const auto sa = suffix_array<int16_t>(in);
-    const auto [lcp, rank] = sa.lcp_rank();
-    this->rank = std::move(rank);
-    this->lcp = decltype(this->lcp)(lcp);
-    seg = decltype(seg)(rank.size());
-    seg_h = decltype(seg_h)(rank.size());
-    seg_v = decltype(seg_v)(rank.size());
-    if (updated) {
-      seg.init([&](size_t i) { return sa[i] < n ? sa[i] : seg.iden; });
-      seg_h.init([&](size_t i) { return n + 1 <= sa[i] && sa[i] < 2 * n + 1 ? sa[i] - (n + 1) : seg_h.iden; });
-      seg_v.init([&](size_t i) { return sa[i] >= 2 * n + 2 ? (3 * n + 1) - sa[i] : seg_v.iden; });
-    }
+  static std::shared_ptr<const match_index_type> analyze(std::span<const uint8_t> input) {
+    return match_index_type::create(hvflip_appended(input));
+  }
+
+  lz_helper_kirby(std::span<const uint8_t> input, bool updated = false)
+      : lz_helper_kirby(analyze(input), updated) {}
+
+  lz_helper_kirby(std::shared_ptr<const match_index_type> index, bool updated = false)
+      : detail::lz_helper_base<int16_t, U, 3>(std::move(index)), n((this->index->size() - 2) / 3) {
+    if (!updated) return;
+    this->visit([&](const auto& a, auto& segs) {
+      const auto& sa = a.sa;
+      segs[0].init_positions([&](size_t i) -> ptrdiff_t { return sa[i] < n ? ptrdiff_t(sa[i]) : -1; });
+      segs[1].init_positions([&](size_t i) -> ptrdiff_t {
+        return n + 1 <= sa[i] && sa[i] < 2 * n + 1 ? ptrdiff_t(sa[i] - (n + 1)) : -1;
+      });
+      segs[2].init_positions([&](size_t i) -> ptrdiff_t { return sa[i] >= 2 * n + 2 ? ptrdiff_t((3 * n + 1) - sa[i]) : -1; });
+    });
   }
 
 public:
   encode::lz_data find(size_t pos, size_t max_dist, size_t min_len) const {
-    return encode::lz::find(pos, rank[pos], max_dist, min_len, lcp.nodes(), seg.nodes());
+    return find_(0, pos, max_dist, min_len);
   }
 
   encode::lz_data find_h(size_t pos, size_t max_dist, size_t min_len) const {
-    return encode::lz::find(pos, rank[pos], max_dist, min_len, lcp.nodes(), seg_h.nodes());
+    return find_(1, pos, max_dist, min_len);
   }
 
   encode::lz_data find_v(size_t pos, size_t max_dist, size_t min_len) const {
-    return encode::lz::find(pos, rank[pos], max_dist, min_len, lcp.nodes(), seg_v.nodes());
+    return find_(2, pos, max_dist, min_len);
   }
 
   void add_element(size_t i) {
-    seg.update(rank[i], i);
-    seg_h.update(rank[i + n + 1], i);
-    seg_v.update(rank[3 * n + 1 - i], i);
+    this->visit([&](const auto& a, auto& segs) {
+      segs[0].add(a.rank[i], i);
+      segs[1].add(a.rank[i + n + 1], i);
+      segs[2].add(a.rank[3 * n + 1 - i], i);
+    });
   }
 
   void reset(size_t i) {
-    seg.reset(rank[i]);
-    seg_h.reset(rank[i + n + 1]);
-    seg_v.reset(rank[3 * n + 1 - i]);
+    this->visit([&](const auto& a, auto& segs) {
+      segs[0].reset(a.rank[i]);
+      segs[1].reset(a.rank[i + n + 1]);
+      segs[2].reset(a.rank[3 * n + 1 - i]);
+    });
+  }
+
+private:
+  encode::lz_data find_(size_t t, size_t pos, size_t max_dist, size_t min_len) const {
+    return this->visit([&](const auto& a, const auto& segs) {
+      return encode::lz::find(pos, a.rank[pos], max_dist, min_len, a.lcp, segs[t]);
+    });
   }
 
 private:
   const size_t n;
-  std::vector<index_type> rank;
-  segment_tree<range_min<index_type>> lcp;
-  segment_tree<range_max<signed_index_type>> seg, seg_h, seg_v;
 };
 
 template <typename U = uint32_t>
@@ -342,57 +847,229 @@ class non_overlapping_lz_helper {
  public:
   using index_type = U;
   using signed_index_type = std::make_signed_t<index_type>;
+  using match_index_type = match_index<uint8_t, index_type>;
 
-  non_overlapping_lz_helper(std::span<const uint8_t> input) : n(input.size()), sa(input) {
-    const auto [lcp, rank]= sa.lcp_rank();
-    this->rank = std::move(rank);
-    this->wm = decltype(wm)(this->rank);
-    this->lcp = decltype(this->lcp)(lcp);
+  non_overlapping_lz_helper(std::span<const uint8_t> input)
+      : non_overlapping_lz_helper(match_index_type::create(input)) {}
+
+  non_overlapping_lz_helper(std::shared_ptr<const match_index_type> index) : index(std::move(index)) {
+    this->index->visit([&](const auto& a) {
+      using T = typename std::remove_cvref_t<decltype(a)>::index_type;
+      std::get<wavelet_matrix<T>>(wms) = wavelet_matrix<T>(a.rank);
+      auto& seg = std::get<offset_tree<T>>(segs);
+      seg = offset_tree<T>(a.sa.size());
+      seg.init_positions([&](size_t i) { return a.sa[i]; });
+    });
   }
 
+  // Most queries only need the first few entries of the rank chains; the wavelet matrix
+  // answers the rest.
   encode::lz_data find_non_overlapping(const size_t adr, const size_t max_dist,
       const encode::lz_data prev = {}) const {
     const size_t adr_l = (adr < max_dist) ? 0 : adr - max_dist;
-    const size_t rank = this->rank[adr];
-    return encode::lz::find_non_overlapping(adr_l, adr, [&](size_t adr_r) {
-      return encode::lz::find(adr_l, adr_r, rank, wm, lcp, sa);
-    }, prev);
+    return index->visit([&](const auto& a) {
+      using T = typename std::remove_cvref_t<decltype(a)>::index_type;
+      const auto& wm = wm_for(a);
+      const size_t rank = a.rank[adr];
+      encode::lz::nearest_rank_chains chains(adr, adr_l, rank, a.lcp, std::get<offset_tree<T>>(segs));
+      return encode::lz::find_non_overlapping(adr_l, adr, [&](size_t adr_r) {
+        if (const auto res = chains.find(adr_r)) return *res;
+        return encode::lz::find(adr_l, adr_r, rank, wm, a.lcp, std::span(a.sa));
+      }, prev);
+    });
   }
 
   encode::lz_data find(const size_t adr, const size_t max_dist) const {
     const size_t adr_l = (adr < max_dist) ? 0 : adr - max_dist;
-    return encode::lz::find(adr_l, adr, rank[adr], wm, lcp, sa);
+    return index->visit([&](const auto& a) {
+      return encode::lz::find(adr_l, adr, a.rank[adr], wm_for(a), a.lcp, std::span(a.sa));
+    });
   }
 
  private:
-  const size_t n;
-  suffix_array<uint8_t> sa;
-  std::vector<index_type> rank;
-  wavelet_matrix<index_type> wm;
-  segment_tree<range_min<index_type>> lcp;
-};
+  template <typename T>
+  const wavelet_matrix<T>& wm_for(const match_arrays<T>&) const {
+    return std::get<wavelet_matrix<T>>(wms);
+  }
 
-struct vrange {
-  size_t min;
-  size_t max;
-  size_t bitlen;
-  uint64_t val;
-  uint64_t mask = -1;
+  std::shared_ptr<const match_index_type> index;
+  std::conditional_t<match_index_type::compact_enabled,
+    std::tuple<wavelet_matrix<typename match_index_type::compact_index_type>, wavelet_matrix<index_type>>,
+    std::tuple<wavelet_matrix<index_type>>> wms;
+  std::conditional_t<match_index_type::compact_enabled,
+    std::tuple<offset_tree<typename match_index_type::compact_index_type>, offset_tree<index_type>>,
+    std::tuple<offset_tree<index_type>>> segs;
 };
 
-struct vrange_min {
-  size_t min;
-  size_t bitlen;
-  uint64_t val;
-  uint64_t mask = -1;
+// Per-position match candidates for a fixed number of buckets (e.g. offset ranges).
+// A row only keeps the buckets whose match differs from the previous bucket,
+// so runs of equal matches (as written by find_all) are stored once.
+// Offsets are stored in 32 bits and lengths are saturated to 0xffff.
+class lz_memo_table {
+ public:
+  struct entry {
+    uint32_t ofs;
+    uint16_t len;
+    uint16_t bucket; // first bucket of the run
+  };
+
+  class row {
+   public:
+    class iterator {
+     public:
+      using iterator_category = std::bidirectional_iterator_tag;
+      using difference_type = ptrdiff_t;
+      using value_type = encode::lz_data;
+      using reference = encode::lz_data;
+
+      iterator() = default;
+      iterator(std::span<const entry> entries, size_t k, size_t e) : entries(entries), k(k), e(e) {}
+      encode::lz_data operator * () const {
+        return (e == 0) ? encode::lz_data(0, 0) : encode::lz_data(entries[e - 1].ofs, entries[e - 1].len);
+      }
+      iterator& operator ++ () {
+        ++k;
+        if (e < entries.size() && entries[e].bucket <= k) ++e;
+        return *this;
+      }
+      iterator operator ++ (int) { iterator ret = *this; ++(*this); return ret; }
+      iterator& operator -- () {
+        --k;
+        if (e > 0 && entries[e - 1].bucket > k) --e;
+        return *this;
+      }
+      iterator operator -- (int) { iterator ret = *this; --(*this); return ret; }
+      friend bool operator == (const iterator& lhs, const iterator& rhs) { return lhs.k == rhs.k; }
+
+     private:
+      std::span<const entry> entries;
+      size_t k = 0;
+      size_t e = 0; // the number of entries whose run starts at or before bucket k
+    };
+
+    row(std::span<const entry> entries, size_t buckets) : entries(entries), buckets(buckets) {}
+
+    encode::lz_data operator [] (size_t k) const {
+      for (size_t e = entries.size(); e-- > 0; ) {
+        if (entries[e].bucket <= k) return {entries[e].ofs, entries[e].len};
+      }
+      return {0, 0};
+    }
+    encode::lz_data front() const { return (*this)[0]; }
+    encode::lz_data back() const { return (*this)[buckets - 1]; }
+    size_t size() const { return buckets; }
+    iterator begin() const { return {entries, 0, size_t(!entries.empty() && entries[0].bucket == 0)}; }
+    iterator end() const { return {entries, buckets, entries.size()}; }
+
+   private:
+    std::span<const entry> entries;
+    size_t buckets;
+  };
+
+  lz_memo_table(size_t buckets) : buckets(buckets), starts{0} {
+    if (buckets > std::numeric_limits<uint16_t>::max()) {
+      throw std::logic_error("Too many buckets.");
+    }
+  }
+
+  void reserve(size_t rows) { starts.reserve(rows + 1); }
+
+  void push_back(std::span<const encode::lz_data> matches) {
+    assert(matches.size() == buckets);
+    entry prev = {0, 0, 0};
+    for (size_t k = 0; k < matches.size(); ++k) {
+      assert(matches[k].ofs <= std::numeric_limits<uint32_t>::max());
+      const entry e = {
+        uint32_t(matches[k].ofs), uint16_t(std::min<size_t>(matches[k].len, 0xffff)), uint16_t(k)
+      };
+      if (e.ofs == prev.ofs && e.len == prev.len) continue;
+      entries.push_back(e);
+      prev = e;
+    }
+    if (entries.size() > std::numeric_limits<uint32_t>::max()) throw std::runtime_error("Too many entries.");
+    starts.push_back(entries.size());
+  }
+
+  row operator [] (size_t i) const {
+    return row(std::span(entries.begin() + starts[i], entries.begin() + starts[i + 1]), buckets);
+  }
+  size_t size() const { return starts.size() - 1; }
+
+ private:
+  size_t buckets;
+  std::vector<uint32_t> starts;
+  std::vector<entry> entries;
 };
 
-template <size_t N>
-constexpr std::array<vrange, N> to_vranges(vrange_min (&&a)[N], size_t max_len) {
-  return create_array<vrange, N>([&](size_t i) {
-    return vrange(a[i].min, (i + 1 == N) ? max_len : a[i + 1].min - 1, a[i].bitlen, a[i].val, a[i].mask);
-  });
-}
+// Finds matches through hash chains of the first `key_len` (<= 3) bytes, visiting at most `max_chain`
+// candidates per query. Much cheaper to build than `lz_helper`, but the match found is not always
+// the longest one. Only the positions passed to `add_element` are candidates.
+class hash_chain_lz_helper {
+ public:
+  static constexpr size_t hash_bits = 15;
+
+  hash_chain_lz_helper(std::span<const uint8_t> input, size_t key_len, size_t max_chain)
+      : input(input), key_len(key_len), max_chain(max_chain),
+        head(size_t(1) << hash_bits, npos), prev(input.size(), npos) {
+    assert(1 <= key_len && key_len <= 3);
+    if (input.size() > npos) throw std::length_error("Input too large for hash_chain_lz_helper.");
+  }
+
+  encode::lz_data find(size_t pos, size_t max_dist, size_t min_len, size_t max_len = -1) const {
+    if (pos + key_len > input.size()) return {0, 0};
+    return find_from(head[hash(pos)], pos, pos, max_dist, min_len, max_len);
+  }
+
+  // Same as `find`, but the candidates are the positions added before `pos` that are less than
+  // `limit`, where `pos` itself must have been added (e.g. every position is added up front and
+  // `limit` is lowered as an `lz_helper` built with `updated` would be reset).
+  encode::lz_data find_added(size_t pos, size_t limit, size_t max_dist, size_t min_len,
+      size_t max_len = -1) const {
+    if (pos + key_len > input.size()) return {0, 0};
+    return find_from(prev[pos], pos, limit, max_dist, min_len, max_len);
+  }
+
+  void add_element(size_t pos) {
+    if (pos + key_len > input.size()) return;
+    const size_t h = hash(pos);
+    prev[pos] = head[h];
+    head[h] = pos;
+  }
+
+ private:
+  static constexpr size_t npos = std::numeric_limits<uint32_t>::max();
+
+  encode::lz_data find_from(size_t p, size_t pos, size_t limit, size_t max_dist, size_t min_len,
+      size_t max_len) const {
+    assert(min_len >= key_len);
+    encode::lz_data ret = {0, 0};
+    const size_t lim = std::min(max_len, input.size() - pos);
+    for (; p != npos && p >= std::min(pos, limit); p = prev[p]);
+    size_t chain = max_chain;
+    for (; p != npos && pos - p <= max_dist && chain-- > 0; p = prev[p]) {
+      size_t l = 0;
+      while (l < lim && input[p + l] == input[pos + l]) ++l;
+      if (l > ret.len) {
+        ret = {p, l};
+        if (l == lim) break;
+      }
+    }
+    if (ret.len < min_len) ret = {0, 0};
+    return ret;
+  }
+
+  size_t hash(size_t pos) const {
+    uint32_t v = 0;
+    for (size_t k = 0; k < key_len; ++k) v = v << 8 | input[pos + k];
+    return (v * uint32_t(0x9e3779b1)) >> (32 - hash_bits);
+  }
+
+  std::span<const uint8_t> input;
+  const size_t key_len;
+  const size_t max_chain;
+  std::vector<uint32_t> head;
+  std::vector<uint32_t> prev;
+};
 
 namespace encode::lz {
 
@@ -426,6 +1103,109 @@ void find_all(size_t i, std::span<const vrange> offsets, const size_t lz_min_len
 
 } // namespace encode::lz
 
+// The lz helper of the formats that only need the longest match of each position (or of each offset
+// bucket), through `find`, `find_closest` or `find_all` after `reset` (with `updated`) or
+// `add_element`, as with `Helper`.
+// Below level::optimal, the matches come from a hash_chain_lz_helper (8 candidates per query at
+// level::greedy, 32 at level::lazy) instead of the suffix array of `Helper`. They are then cut at
+// `max_len`, and queries for fewer than min(`min_len`, 3) bytes find nothing.
+template <typename Helper = lz_helper<>>
+class level_lz_helper {
+ public:
+  using match_index_type = typename Helper::match_index_type;
+
+  level_lz_helper(std::span<const uint8_t> input, bool updated, size_t min_len, size_t max_len)
+      : level_lz_helper(input, updated, min_len, max_len, [&] { return Helper(input, updated); }) {}
+
+  // Same as above with a shared match index (e.g. from `analyze`), which is only used at
+  // level::optimal and may be null below it.
+  level_lz_helper(std::span<const uint8_t> input, std::shared_ptr<const match_index_type> index,
+      bool updated, size_t min_len, size_t max_len)
+      : level_lz_helper(input, updated, min_len, max_len, [&] { return Helper(index, updated); }) {
+    assert(!exact || index);
+  }
+
+  // The match index to share among the helpers of `input`, or null if they do not need one.
+  static std::shared_ptr<const match_index_type> analyze(std::span<const uint8_t> input) {
+    if (level::current() < level::optimal) return nullptr;
+    if constexpr (requires { Helper::analyze(input); }) return Helper::analyze(input);
+    else return match_index_type::create(input);
+  }
+
+  encode::lz_data find(size_t pos, size_t max_dist, size_t min_len) const {
+    if (exact) return exact->find(pos, max_dist, min_len);
+    return find_chain(pos, max_dist, min_len, max_len);
+  }
+
+  encode::lz_data find_closest(size_t pos, size_t max_dist, size_t min_len, size_t max_len) const {
+    if (exact) return exact->find_closest(pos, max_dist, min_len, max_len);
+    return find_chain(pos, max_dist, min_len, std::min(max_len, this->max_len));
+  }
+
+  void reset(size_t i) {
+    if (exact) exact->reset(i);
+    else limit = std::min(limit, i);
+  }
+
+  void add_element(size_t i) {
+    if (exact) exact->add_element(i);
+    else chain->add_element(i);
+  }
+
+  // Same as `Helper::find_all`: dest[k] is the longest match within the k-th limit.
+  template <typename Offsets>
+  void find_all(size_t pos, const Offsets& offsets, size_t min_len, std::span<encode::lz_data> dest) const {
+    if (exact) return exact->find_all(pos, offsets, min_len, dest);
+    encode::lz::find_all(pos, std::span(offsets), min_len, dest, [&](size_t max_dist) {
+      return find_chain(pos, max_dist, min_len, max_len);
+    });
+  }
+
+  // Same as `Helper::find_all_closest`. Below level::optimal, the chain already visits the closest
+  // candidates first, so this is `find_all` with `max_len`.
+  template <typename Offsets>
+  void find_all_closest(size_t pos, const Offsets& offsets, size_t min_len, size_t max_len,
+      std::span<encode::lz_data> dest) const {
+    if (exact) return exact->find_all_closest(pos, offsets, min_len, max_len, dest);
+    encode::lz::find_all(pos, std::span(offsets), min_len, dest, [&](size_t max_dist) {
+      return find_chain(pos, max_dist, min_len, std::min(max_len, this->max_len));
+    });
+  }
+
+  // The helper of level::optimal for its other queries (e.g. `find_c`), or null below it.
+  const Helper* optimal() const {
+    return exact ? &*exact : nullptr;
+  }
+
+ private:
+  template <typename MakeHelper>
+  level_lz_helper(std::span<const uint8_t> input, bool updated, size_t min_len, size_t max_len,
+      MakeHelper&& make_helper)
+      : updated(updated), key_len(std::clamp<size_t>(min_len, 1, 3)), max_len(max_len), limit(input.size()) {
+    if (const size_t lv = level::use(); lv < level::optimal) {
+      chain.emplace(input, key_len, (lv == level::lazy) ? 32 : 8);
+      if (updated) {
+        for (size_t i = 0; i < input.size(); ++i) chain->add_element(i);
+      }
+    } else {
+      exact.emplace(make_helper());
+    }
+  }
+
+  encode::lz_data find_chain(size_t pos, size_t max_dist, size_t min_len, size_t max_len) const {
+    if (min_len < key_len) return {0, 0};
+    if (updated) return chain->find_added(pos, limit, max_dist, min_len, max_len);
+    return chain->find(pos, max_dist, min_len, max_len);
+  }
+
+  std::optional<Helper> exact;
+  std::optional<hash_chain_lz_helper> chain;
+  bool updated;
+  size_t key_len;
+  size_t max_len;
+  size_t limit;
+};
+
 namespace detail {
 
 template <typename LzFunc, typename Func>
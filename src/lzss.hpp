@@ -1,22 +1,29 @@
 #pragma once
 
+#include <optional>
+
 #include "algorithm.hpp"
 #include "encode.hpp"
+#include "options.hpp"
 #include "utility.hpp"
 #include "writer.hpp"
 
 namespace sfc_comp {
 
-template <class Writer, typename InitFunc, typename LzEncoding>
+// Gives up and returns std::nullopt if `skip(size)` returns true,
+// where `size` is a lower bound of the output size known before the output is written.
+// Below level::optimal, the commands come from `greedy_path` instead of the DP.
+template <class Writer, typename InitFunc, typename LzEncoding, typename SkipFunc>
 requires std::derived_from<Writer, writer> &&
          std::invocable<InitFunc, std::span<uint8_t>> &&
-         std::invocable<LzEncoding, size_t, size_t, size_t>
-std::vector<uint8_t> lzss(
+         std::invocable<LzEncoding, size_t, size_t, size_t> &&
+         std::predicate<SkipFunc, size_t>
+std::optional<std::vector<uint8_t>> lzss(
     std::span<const uint8_t> in,
     const size_t pad, InitFunc&& init,
     const size_t lz_max_ofs, const size_t lz_min_len, const size_t lz_max_len,
     const size_t header_size,
-    const bool uncomp_b, LzEncoding&& lz_enc) {
+    const bool uncomp_b, LzEncoding&& lz_enc, SkipFunc&& skip) {
 
   enum tag { uncomp, lz };
   std::vector<uint8_t> input(in.size() + pad);
@@ -24,8 +31,39 @@ std::vector<uint8_t> lzss(
 
   init(input);
 
+  const auto write = [&](const auto& path, size_t cost) -> std::optional<std::vector<uint8_t>> {
+    if (skip((cost + header_size * 8 + 7) / 8)) return std::nullopt;
+
+    using namespace data_type;
+    Writer ret(header_size);
+    // Each command has a flag bit, and the flags are packed into the blocks of the writer.
+    const size_t flags = path.size(), block_bits = Writer::block_bitsize;
+    ret.reserve(header_size + (cost - flags) / 8 + (flags + block_bits - 1) / block_bits * (block_bits / 8));
+
+    size_t adr = pad;
+    for (const auto& cmd : path) {
+      switch (cmd.type) {
+      case uncomp: ret.template write<b1, d8>(uncomp_b, input[adr]); break;
+      case lz: ret.template write<b1, d16>(!uncomp_b, lz_enc(adr, cmd.lz_ofs(), cmd.len)); break;
+      default: assert(0);
+      }
+      adr += cmd.len;
+    }
+    assert(cost + header_size * 8 == ret.bit_length());
+    assert(adr == input.size());
+    return std::move(ret.out);
+  };
+
+  if (const size_t lv = level::use(); lv < level::optimal) {
+    const auto path = greedy_path<tag>(input, pad, lz_max_ofs, lz_min_len, lz_max_len,
+                                       uncomp, lz, lv == level::lazy);
+    size_t cost = 0;
+    for (const auto& cmd : path) cost += (cmd.type == uncomp) ? 9 : 17;
+    return write(path, cost);
+  }
+
   lz_helper lz_helper(input, true);
-  solver<tag> dp(input.size()); auto c0 = dp.template c<0>(lz_max_len);
+  solver<tag> dp(input.size()); auto c0 = dp.template c_mono<0>(lz_min_len, lz_max_len);
 
   for (size_t i = input.size(); i-- > pad; ) {
     lz_helper.reset(i);
@@ -34,22 +72,22 @@ std::vector<uint8_t> lzss(
     dp.update(i, lz_min_len, lz_max_len, res_lz, c0, 17, lz);
     c0.update(i);
   }
+  return write(dp.optimal_path(pad), dp.optimal_cost(pad));
+}
 
-  using namespace data_type;
-  Writer ret(header_size);
-
-  size_t adr = pad;
-  for (const auto& cmd : dp.optimal_path(pad)) {
-    switch (cmd.type) {
-    case uncomp: ret.template write<b1, d8>(uncomp_b, input[adr]); break;
-    case lz: ret.template write<b1, d16>(!uncomp_b, lz_enc(adr, cmd.lz_ofs(), cmd.len)); break;
-    default: assert(0);
-    }
-    adr += cmd.len;
-  }
-  assert(dp.optimal_cost(pad) + header_size * 8 == ret.bit_length());
-  assert(adr == input.size());
-  return ret.out;
+template <class Writer, typename InitFunc, typename LzEncoding>
+requires std::derived_from<Writer, writer> &&
+         std::invocable<InitFunc, std::span<uint8_t>> &&
+         std::invocable<LzEncoding, size_t, size_t, size_t>
+std::vector<uint8_t> lzss(
+    std::span<const uint8_t> in,
+    const size_t pad, InitFunc&& init,
+    const size_t lz_max_ofs, const size_t lz_min_len, const size_t lz_max_len,
+    const size_t header_size,
+    const bool uncomp_b, LzEncoding&& lz_enc) {
+  return *lzss<Writer>(in, pad, std::forward<InitFunc>(init),
+                       lz_max_ofs, lz_min_len, lz_max_len, header_size,
+                       uncomp_b, std::forward<LzEncoding>(lz_enc), [](size_t) { return false; });
 }
 
 } // namespace sfc_comp
@@ -22,7 +22,7 @@ std::vector<uint8_t> madara2_comp(std::span<const uint8_t> in) {
   std::vector<uint8_t> input(in.size() + pad);
   std::ranges::copy(in, input.begin() + pad);
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 2, 0x11);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(0x3ff);
   auto c1 = dp.c<1>(0x20);
@@ -70,6 +70,7 @@ std::vector<uint8_t> madara2_comp(std::span<const uint8_t> in) {
 
   using namespace data_type;
   writer ret(2);
+  ret.reserve(dp.optimal_cost(pad) + 2);
   size_t adr = pad;
   for (const auto& cmd : dp.optimal_path(pad)) {
     switch (cmd.type) {
@@ -119,7 +120,7 @@ std::vector<uint8_t> madara2_comp(std::span<const uint8_t> in) {
   write16(ret.out, 0, ret.size());
   assert(dp.optimal_cost(pad) + 2 == ret.size());
   assert(adr == input.size());
-  return ret.out;
+  return std::move(ret.out);
 }
 
 } // namespace sfc_comp
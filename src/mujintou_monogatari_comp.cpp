@@ -10,7 +10,7 @@ std::vector<uint8_t> mujintou_monogatari_comp(std::span<const uint8_t> input) {
 
   enum tag { uncomp, lz, lzl };
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 3, 3 + 0x0f + 0xff);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(3 + 0x0f + 0xff);
 
@@ -44,8 +44,9 @@ std::vector<uint8_t> nba_jam_comp(std::span<const uint8_t> in) {
 
   std::vector<uint8_t> input(in.rbegin(), in.rend());
 
-  non_overlapping_lz_helper nlz_helper(input);
-  lz_helper lz_helper(input, true);
+  const auto index = match_index<>::create(input);
+  non_overlapping_lz_helper nlz_helper(index);
+  level_lz_helper lz_helper(input, index, true, lz_min_len, lz_min_len);
   solver<tag> dp0(input.size()), dp1(input.size());
   auto c0_0 = dp0.c<0>(len_tab.back().max);
   auto c8_1 = dp1.c<8>(ulen_tab.back().max);
@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <mutex>
+
+#include "options.hpp"
+
+namespace sfc_comp {
+
+namespace {
+
+thread_local detail::context current_ctx;
+std::mutex stats_mutex;
+
+} // namespace
+
+namespace level {
+
+scope::scope(size_t level) : prev_level(current_ctx.opts.level) {
+  current_ctx.opts.level = std::min(level, optimal);
+}
+
+scope::~scope() {
+  current_ctx.opts.level = prev_level;
+}
+
+size_t current() {
+  return current_ctx.opts.level;
+}
+
+size_t use() {
+  const size_t lv = current_ctx.opts.level;
+  if (lv < optimal && current_ctx.leveled) current_ctx.leveled->store(true, std::memory_order_relaxed);
+  return lv;
+}
+
+} // namespace level
+
+namespace detail {
+
+const context& current_context() {
+  return current_ctx;
+}
+
+context_scope::context_scope(const context& ctx) : prev(current_ctx) {
+  current_ctx = ctx;
+  current_ctx.opts.level = std::min(ctx.opts.level, level::optimal);
+}
+
+context_scope::~context_scope() {
+  current_ctx = prev;
+}
+
+bool interrupted() {
+  const auto& opts = current_ctx.opts;
+  const bool stop = (opts.cancel && opts.cancel->cancelled()) ||
+      (opts.deadline != std::chrono::steady_clock::time_point::max() &&
+       std::chrono::steady_clock::now() >= opts.deadline);
+  if (stop && current_ctx.incomplete) current_ctx.incomplete->store(true, std::memory_order_relaxed);
+  return stop;
+}
+
+void record_refinement(std::span<const double> seconds) {
+  if (!current_ctx.opts.stats) return;
+  std::lock_guard lock(stats_mutex);
+  auto& stats = *current_ctx.opts.stats;
+  stats.iterations.push_back(seconds.size());
+  stats.seconds.insert(stats.seconds.end(), seconds.begin(), seconds.end());
+}
+
+} // namespace detail
+
+result compress(std::vector<uint8_t> (*comp)(std::span<const uint8_t>),
+                std::span<const uint8_t> input, const options& opts) {
+  std::atomic<bool> incomplete = false, leveled = false;
+  std::vector<uint8_t> out;
+  {
+    detail::context_scope scope({opts, &incomplete, &leveled});
+    out = comp(input);
+  }
+  const size_t lv = leveled.load() ? std::min(opts.level, level::optimal) : level::optimal;
+  return {std::move(out), !incomplete.load(), lv};
+}
+
+} // namespace sfc_comp
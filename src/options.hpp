@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <span>
+
+#include "sfc_comp.hpp"
+
+namespace sfc_comp {
+
+namespace level {
+
+// The level of the compression running on the calling thread.
+size_t current();
+
+// Same as `current`, for a format that runs the parser of the returned level.
+// Below level::optimal, it records that the level was applied (see `result::level`).
+size_t use();
+
+} // namespace level
+
+namespace detail {
+
+// The options of a compression and the flags that record what it did.
+struct context {
+  options opts;
+  std::atomic<bool>* incomplete = nullptr;
+  std::atomic<bool>* leveled = nullptr; // set once a cheaper parser runs
+};
+
+// The context of the compression running on the calling thread.
+const context& current_context();
+
+inline const options& current_options() {
+  return current_context().opts;
+}
+
+// Sets the context of the calling thread while alive.
+class context_scope {
+ public:
+  explicit context_scope(const context& ctx);
+  ~context_scope();
+  context_scope(const context_scope&) = delete;
+  context_scope& operator = (const context_scope&) = delete;
+
+ private:
+  context prev;
+};
+
+// Whether the deadline of the current options has passed or their token has been cancelled.
+// If so, the result is marked as incomplete, so call it only where a search is about to stop.
+bool interrupted();
+
+// Appends one refinement loop to `current_options().stats`, if any.
+void record_refinement(std::span<const double> seconds);
+
+} // namespace detail
+
+} // namespace sfc_comp
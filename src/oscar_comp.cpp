@@ -24,16 +24,18 @@ std::vector<uint8_t> oscar_comp(std::span<const uint8_t> input) {
                     : vrange((1 << (k - 1)) + min_len, (1 << k) + (min_len - 1), 3 + (k - 1), k << (k - 1));
   });
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, len_tab.front().min, len_tab.back().max);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(len_tab.back().max);
   auto c8 = dp.c<8>(ulen_tab.back().max);
 
+  std::array<encode::lz_data, ofs_tab.size()> lz_memo;
   for (size_t i = input.size(); i-- > 0; ) {
     lz_helper.reset(i);
     dp.update(i, ulen_tab, c8, 4, [&](size_t li) -> tag { return {uncomp, 0, li}; });
+    lz_helper.find_all(i, ofs_tab, len_tab.front().min, lz_memo);
     dp.update_matrix(i, ofs_tab, len_tab, c0, 0,
-      [&](size_t oi) { return lz_helper.find(i, ofs_tab[oi].max, len_tab.front().min); },
+      [&](size_t oi) { return lz_memo[oi]; },
       [&](size_t oi, size_t li) -> tag { return {lz, oi, li}; }
     );
     c0.update(i); c8.update(i);
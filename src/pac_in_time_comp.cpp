@@ -103,7 +103,7 @@ std::vector<uint8_t> diet_comp_core(std::span<const uint8_t> input, const size_t
 std::vector<uint8_t> diet_comp(std::span<const uint8_t> input) {
   check_size(input.size(), 0, 0xffff);
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 2, 0x110);
   auto ret = diet_comp_core(input, 0x11,
     [&](size_t i, size_t max_dist, size_t min_len) { return lz_helper.find(i, max_dist, min_len); },
     [&](size_t i) { lz_helper.reset(i); }
@@ -165,16 +165,14 @@ std::vector<uint8_t> pac_in_time_comp_a44a(std::span<const uint8_t> input) {
   static constexpr auto ofs_tab_b = std::span(ofs_tab.begin() + 4, ofs_tab.size() - 4);
 
   auto lz_helpers = [&] {
-    lz_helper even(input); lz_helper odd(even);
+    level_lz_helper even(input, false, lz_min_len, len_tab.back().max); level_lz_helper odd(even);
     return std::to_array({std::move(even), std::move(odd)});
   }();
   std::vector<std::array<encode::lz_data, ofs_tab.size()>> lz_memo(input.size(), {{}});
   for (size_t i = 0; i < input.size(); ++i) {
     const auto f = [&](std::span<const vrange> o_tab, size_t beg) {
       if (size_t j = i + o_tab.front().min; j < input.size()) {
-        encode::lz::find_all(j, o_tab, lz_min_len, std::span(lz_memo[j].data() + beg, o_tab.size()),
-          [&](size_t max_ofs) { return lz_helpers[j & 1].find(j, max_ofs, lz_min_len); }
-        );
+        lz_helpers[j & 1].find_all(j, o_tab, lz_min_len, std::span(lz_memo[j].data() + beg, o_tab.size()));
       }
     };
     lz_helpers[i & 1].add_element(i);
@@ -267,15 +265,17 @@ std::vector<uint8_t> pac_in_time_comp_a55a(std::span<const uint8_t> input) {
     {0x1001, 16, 0b0000000'1'111'00000},
   }, 0x2000);
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, len_tab.front().min, len_tab.back().max);
   solver<tag> dp(input.size()); auto c0 = dp.c<0>(len_tab.back().max);
 
   if (input.size() > 0) lz_helper.reset(input.size() - 1);
+  std::array<encode::lz_data, ofs_tab.size()> lz_memo;
   for (size_t i = input.size(); i-- > 0; ) {
     if (i > 0) lz_helper.reset(i - 1);
     dp.update(i, 1, 9, {uncomp, 0, 0});
+    lz_helper.find_all(i, ofs_tab, len_tab.front().min, lz_memo);
     dp.update_matrix(i, ofs_tab, len_tab, c0, 1,
-      [&](size_t oi) { return lz_helper.find(i, ofs_tab[oi].max, len_tab.front().min); },
+      [&](size_t oi) { return lz_memo[oi]; },
       [&](size_t oi, size_t li) -> tag { return {lz, oi, li}; }
     );
     c0.update(i);
@@ -13,7 +13,7 @@ std::vector<uint8_t> papuwa_comp(std::span<const uint8_t> input) {
     lzs, lzm, lzls, lzlm, lzll
   };
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 3, 0x8206);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(0x8206);
   auto c1 = dp.c<1>(0x11 + 0x03ff);
@@ -33,6 +33,7 @@ std::vector<uint8_t> papuwa_comp(std::span<const uint8_t> input) {
 
   using namespace data_type;
   writer ret(2);
+  ret.reserve(dp.optimal_cost() + 2);
   size_t adr = 0;
   for (const auto& cmd : dp.optimal_path()) {
     size_t d = adr - cmd.lz_ofs();
@@ -57,7 +58,7 @@ std::vector<uint8_t> papuwa_comp(std::span<const uint8_t> input) {
   write16(ret.out, 0, input.size());
   assert(dp.optimal_cost() + 2 == ret.size());
   assert(adr == input.size());
-  return ret.out;
+  return std::move(ret.out);
 }
 
 } // namespace sfc_comp
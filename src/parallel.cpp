@@ -0,0 +1,124 @@
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "options.hpp"
+#include "parallel.hpp"
+
+namespace sfc_comp {
+
+namespace parallel {
+
+namespace {
+
+std::atomic<size_t> num_threads = 1;
+std::atomic<size_t> min_input_size = 0x100000;
+
+class thread_pool {
+  struct job {
+    job(const std::function<void(size_t)>& task, size_t n) : task(task), n(n) {}
+    const std::function<void(size_t)>& task;
+    const size_t n;
+    std::atomic<size_t> next = 0;
+    size_t done = 0;
+    std::mutex mtx;
+    std::condition_variable cv;
+  };
+
+ public:
+  static thread_pool& instance() {
+    static thread_pool pool;
+    return pool;
+  }
+
+  ~thread_pool() {
+    {
+      std::lock_guard lock(mtx);
+      stop = true;
+    }
+    cv.notify_all();
+    for (auto& th : threads) th.join();
+  }
+
+  void run(size_t n, size_t workers, const std::function<void(size_t)>& task) {
+    const auto j = std::make_shared<job>(task, n);
+    {
+      std::lock_guard lock(mtx);
+      while (threads.size() + 1 < workers) threads.emplace_back([this] { loop(); });
+      for (size_t t = 1; t < workers; ++t) jobs.push_back(j);
+    }
+    cv.notify_all();
+    work(*j);
+    std::unique_lock lock(j->mtx);
+    j->cv.wait(lock, [&] { return j->done == j->n; });
+  }
+
+ private:
+  thread_pool() = default;
+
+  static void work(job& j) {
+    for (size_t k; (k = j.next++) < j.n; ) {
+      j.task(k);
+      std::lock_guard lock(j.mtx);
+      if (++j.done == j.n) j.cv.notify_all();
+    }
+  }
+
+  void loop() {
+    for (;;) {
+      std::shared_ptr<job> j;
+      {
+        std::unique_lock lock(mtx);
+        cv.wait(lock, [&] { return stop || !jobs.empty(); });
+        if (stop) return;
+        j = std::move(jobs.front()); jobs.pop_front();
+      }
+      work(*j);
+    }
+  }
+
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::deque<std::shared_ptr<job>> jobs;
+  std::vector<std::thread> threads;
+  bool stop = false;
+};
+
+} // namespace
+
+void set_threads(size_t threads) {
+  if (threads == 0) threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+  num_threads = threads;
+}
+
+void set_min_size(size_t size) {
+  min_input_size = size;
+}
+
+size_t threads() {
+  return num_threads;
+}
+
+size_t min_size() {
+  return min_input_size;
+}
+
+void run(size_t n, size_t workers, const std::function<void(size_t)>& task) {
+  workers = std::max<size_t>(1, std::min(workers, n));
+  if (workers == 1) {
+    for (size_t k = 0; k < n; ++k) task(k);
+    return;
+  }
+  // Pool threads compress with the options of the caller.
+  thread_pool::instance().run(n, workers, [&task, ctx = detail::current_context()](size_t k) {
+    detail::context_scope scope(ctx);
+    task(k);
+  });
+}
+
+} // namespace parallel
+
+} // namespace sfc_comp
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstddef>
+#include <cassert>
+
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "options.hpp"
+
+namespace sfc_comp {
+
+namespace parallel {
+
+void set_threads(size_t threads);
+void set_min_size(size_t size);
+
+size_t threads();
+size_t min_size();
+
+// The number of workers used for a job of the given size.
+inline size_t workers(size_t size) {
+  return (size < min_size()) ? 1 : std::max<size_t>(1, std::min(threads(), size));
+}
+
+// The number of ranges that `for_each_block` splits [0, n) into.
+inline size_t blocks(size_t n, size_t workers) {
+  return std::max<size_t>(1, std::min(workers, n));
+}
+
+// Calls `task(k)` for every k in [0, n) on at most `workers` threads of a shared pool.
+// The calling thread takes part, so nested calls cannot run out of threads. `task` must not throw.
+void run(size_t n, size_t workers, const std::function<void(size_t)>& task);
+
+// Splits [0, n) into `blocks(n, workers)` contiguous ranges and calls `func(t, begin, end)` for the
+// t-th of them on the shared pool. `func` must not throw.
+template <typename Func>
+requires std::invocable<Func, size_t, size_t, size_t>
+void for_each_block(size_t n, size_t workers, Func&& func) {
+  workers = blocks(n, workers);
+  if (workers == 1) {
+    func(size_t(0), size_t(0), n);
+    return;
+  }
+  const auto range_begin = [&](size_t t) { return n / workers * t + std::min(t, n % workers); };
+  run(workers, workers, [&](size_t t) { func(t, range_begin(t), range_begin(t + 1)); });
+}
+
+// Splits [0, n) into `blocks(n, workers)` contiguous ranges and calls `func(begin, end)` for each of
+// them on the shared pool. `func` must not throw.
+template <typename Func>
+requires std::invocable<Func, size_t, size_t>
+void for_each_range(size_t n, size_t workers, Func&& func) {
+  for_each_block(n, workers, [&func](size_t, size_t beg, size_t end) { func(beg, end); });
+}
+
+// Calls `func(k)` for every k in [0, n) on at most `workers` threads of the shared pool.
+// If some calls throw, the exception of the smallest k is rethrown after all calls have finished.
+template <typename Func>
+requires std::invocable<Func, size_t>
+void for_each(size_t n, size_t workers, Func&& func) {
+  if (std::min(n, workers) <= 1) {
+    for (size_t k = 0; k < n; ++k) func(k);
+    return;
+  }
+  std::vector<std::exception_ptr> errors(n);
+  run(n, workers, [&](size_t k) {
+    try {
+      func(k);
+    } catch (...) {
+      errors[k] = std::current_exception();
+    }
+  });
+  for (const auto& e : errors) {
+    if (e) std::rethrow_exception(e);
+  }
+}
+
+// Calls `produce(k)` for every k in [0, n) on at most `workers` threads of the shared pool and
+// `consume(k, result)` on the calling thread in increasing order of k.
+// With a single worker, each result is consumed as soon as it is produced, so that only one is kept.
+template <typename Produce, typename Consume>
+requires std::invocable<Produce, size_t> &&
+         std::invocable<Consume, size_t, std::invoke_result_t<Produce, size_t>&>
+void produce_in_order(size_t n, size_t workers, Produce&& produce, Consume&& consume) {
+  if (std::min(n, workers) <= 1) {
+    for (size_t k = 0; k < n; ++k) {
+      auto result = produce(k);
+      consume(k, result);
+    }
+    return;
+  }
+  std::vector<std::optional<std::invoke_result_t<Produce, size_t>>> results(n);
+  for_each(n, workers, [&](size_t k) { results[k] = produce(k); });
+  for (size_t k = 0; k < n; ++k) consume(k, *results[k]);
+}
+
+// The (size, index) of the best result that `best_of` has found so far.
+class best_so_far {
+ public:
+  void update(size_t k, size_t size) {
+    std::lock_guard lock(mtx);
+    best = std::min(best, std::pair(size, k));
+  }
+
+  bool beats(size_t k, size_t bound) const {
+    std::lock_guard lock(mtx);
+    return best < std::pair(bound, k);
+  }
+
+  bool found() const {
+    std::lock_guard lock(mtx);
+    return best.second != size_t(-1);
+  }
+
+ private:
+  mutable std::mutex mtx;
+  std::pair<size_t, size_t> best{-1, -1};
+};
+
+// Passed to the k-th call of `best_of`.
+// `beaten(bound)` returns true if a result of size at least `bound` can no longer be chosen, in which
+// case the call may give up and return std::nullopt. The exact cost of a DP, or any cheaper lower
+// bound known before it, can be used as `bound`.
+class candidate {
+ public:
+  candidate(size_t k, const best_so_far& best) : k(k), best(best) {}
+
+  size_t index() const { return k; }
+  bool beaten(size_t bound) const { return best.beats(k, bound); }
+
+ private:
+  const size_t k;
+  const best_so_far& best;
+};
+
+// Calls `func(k, candidate)` for every k in [0, n) and returns the result with the smallest size.
+// Ties go to the smallest k, and an exception of the smallest k that throws is rethrown, so the
+// result is the same as the one of a sequential loop that keeps the first best result.
+// Calls that give up are beaten by some other result, so they do not change it either.
+// Once the compression has been interrupted (see `options::deadline`), the calls that have not
+// started yet are skipped, unless no result has been found so far.
+// `size` is the amount of work of one call (e.g. the input size), see `workers`.
+template <typename Func>
+requires std::invocable<Func, size_t, const candidate&>
+typename std::invoke_result_t<Func, size_t, const candidate&>::value_type
+best_of(size_t n, size_t size, Func&& func) {
+  using result_type = typename std::invoke_result_t<Func, size_t, const candidate&>::value_type;
+  best_so_far best;
+  std::vector<std::optional<result_type>> results(n);
+  const auto call = [&](size_t k) {
+    if (best.found() && detail::interrupted()) return;
+    results[k] = func(k, candidate(k, best));
+    if (results[k]) best.update(k, results[k]->size());
+  };
+  for_each(n, workers(n * size), call);
+  size_t b = n;
+  for (size_t k = 0; k < n; ++k) {
+    if (results[k] && (b == n || results[k]->size() < results[b]->size())) b = k;
+  }
+  assert(b < n);
+  return std::move(*results[b]);
+}
+
+// Same as above for calls that never give up.
+template <typename Func>
+requires std::invocable<Func, size_t>
+std::invoke_result_t<Func, size_t> best_of(size_t n, size_t size, Func&& func) {
+  return best_of(n, size, [&](size_t k, const candidate&) { return std::optional(func(k)); });
+}
+
+} // namespace parallel
+
+} // namespace sfc_comp
@@ -14,7 +14,7 @@ std::vector<uint8_t> pokemon_gold_comp(std::span<const uint8_t> input) {
   static constexpr auto lens = to_vranges({{0x0001, 1, 0}, {0x0021, 2, 0}}, 0x0400);
   static constexpr auto offsets = to_vranges({{0x0001, 1, 0}, {0x0081, 2, 0}}, 0x8000);
 
-  lz_helper_kirby lz_helper(input, true);
+  level_lz_helper<lz_helper_kirby<>> lz_helper(input, true, 2, lens.back().max);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(lens.back().max);
   auto c1 = dp.c<1>(lens.back().max);
@@ -37,20 +37,23 @@ std::vector<uint8_t> pokemon_gold_comp(std::span<const uint8_t> input) {
       [&](size_t oi) { return lz_helper.find(i, offsets[oi].max, 2); },
       [&](size_t oi, size_t li) -> tag { return {lz, oi, li}; }
     );
-    dp.update_matrix(i, offsets, lens, c0, 0,
-      [&](size_t oi) { return lz_helper.find_h(i, offsets[oi].max, 2); },
-      [&](size_t oi, size_t li) -> tag { return {lzh, oi, li}; }
-    );
-    dp.update_matrix(i, offsets, lens, c0, 0,
-      [&](size_t oi) { return lz_helper.find_v(i, offsets[oi].max, 2); },
-      [&](size_t oi, size_t li) -> tag { return {lzv, oi, li}; }
-    );
+    if (const auto* h = lz_helper.optimal()) {
+      dp.update_matrix(i, offsets, lens, c0, 0,
+        [&](size_t oi) { return h->find_h(i, offsets[oi].max, 2); },
+        [&](size_t oi, size_t li) -> tag { return {lzh, oi, li}; }
+      );
+      dp.update_matrix(i, offsets, lens, c0, 0,
+        [&](size_t oi) { return h->find_v(i, offsets[oi].max, 2); },
+        [&](size_t oi, size_t li) -> tag { return {lzv, oi, li}; }
+      );
+    }
 
     c0.update(i); c1.update(i);
   }
 
   using namespace data_type;
   writer ret;
+  ret.reserve(dp.optimal_cost() + 1);
   size_t adr = 0;
   for (const auto& cmd : dp.optimal_path()) {
     const auto [tag, oi, li] = cmd.type;
@@ -72,7 +75,7 @@ std::vector<uint8_t> pokemon_gold_comp(std::span<const uint8_t> input) {
   assert(dp.optimal_cost() == ret.size());
   assert(adr == input.size());
   ret.write<d8>(0xff);
-  return ret.out;
+  return std::move(ret.out);
 }
 
 } // namespace sfc_comp
@@ -10,7 +10,7 @@ std::vector<uint8_t> popful_mail_comp(std::span<const uint8_t> input) {
 
   enum tag { uncomp, uncompl, rle, rlel, lz };
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 4, input.size());
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(0x1003);
   auto c1 = dp.c<1>(0x1fff);
@@ -33,6 +33,7 @@ std::vector<uint8_t> popful_mail_comp(std::span<const uint8_t> input) {
 
   using namespace data_type;
   writer ret(2);
+  ret.reserve(dp.optimal_cost() + 3);
   size_t adr = 0;
   for (const auto& cmd : dp.optimal_path()) {
     const size_t d = adr - cmd.lz_ofs();
@@ -59,7 +60,7 @@ std::vector<uint8_t> popful_mail_comp(std::span<const uint8_t> input) {
   write16(ret.out, 0, ret.out.size() - 2);
   assert(dp.optimal_cost() + 3 == ret.size());
   assert(adr == input.size());
-  return ret.out;
+  return std::move(ret.out);
 }
 
 } // namespace sfc_comp
@@ -9,7 +9,7 @@ std::vector<uint8_t> power_piggs_comp(std::span<const uint8_t> input) {
   check_size(input.size(), 1, 0x8000);
 
   enum tag { uncomp, lz };
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 3, 18);
   solver<tag> dp(input.size()); auto c0 = dp.c<0>(0x12);
 
   for (size_t i = input.size(); i-- > 0; ) {
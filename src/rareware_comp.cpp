@@ -1,5 +1,6 @@
 #include "algorithm.hpp"
 #include "encode.hpp"
+#include "refine.hpp"
 #include "utility.hpp"
 #include "writer.hpp"
 
@@ -47,9 +48,12 @@ std::vector<uint8_t> rareware_comp(std::span<const uint8_t> input) {
 
   std::vector<encode::lz_data> lzl_memo(input.size());
   std::vector<encode::lz_data> lzm_memo(input.size());
-  std::vector<std::array<encode::lz_data, 0x10>> lz_memo(input.size());
+  lz_memo_table lz_memo(0x10); lz_memo.reserve(input.size());
   {
-    lz_helper lz_helper(input);
+    // Row j is written from i = j - 0x12 to i = j - 3, so 0x10 rows are in flight at a time.
+    std::array<std::array<encode::lz_data, 0x10>, 0x10> rows = {};
+    for (size_t j = 0; j < std::min<size_t>(3, input.size()); ++j) lz_memo.push_back(rows[0]);
+    level_lz_helper lz_helper(input, false, 3, 0x12);
     for (size_t i = 0; i < input.size(); ++i) {
       lzl_memo[i] = lz_helper.find(i, 0xffff, 3);
       lz_helper.add_element(i);
@@ -58,9 +62,13 @@ std::vector<uint8_t> rareware_comp(std::span<const uint8_t> input) {
       }
       for (size_t l = 3; l <= 0x12; ++l) {
         if (const size_t j = i + l; j < input.size()) {
-          lz_memo[j][l - 3] = lz_helper.find(j, l + 0xff, l);
+          rows[j % 0x10][l - 3] = lz_helper.find(j, l + 0xff, l);
         }
       }
+      if (const size_t j = i + 3; j < input.size()) {
+        lz_memo.push_back(rows[j % 0x10]);
+        rows[j % 0x10] = {};
+      }
     }
   }
 
@@ -68,10 +76,12 @@ std::vector<uint8_t> rareware_comp(std::span<const uint8_t> input) {
   std::vector<int64_t> pre16(0x10000, -1);
   pre_table pre(input);
 
-  for (size_t iter = 0; iter < iter_total; ++iter) {
+  solver<tag> dp(input.size());
+  refinement refine;
+  for (size_t iter = 0, next = 1; iter < iter_total && refine.next(); iter = next) {
     for (size_t i = 0; i < candidate.size(); ++i) pre16[candidate[i]] = i;
 
-    solver<tag> dp(input.size());
+    if (iter > 0) dp.reset();
 
     size_t rlen = 0;
     for (size_t i = input.size(); i-- > 0; ) {
@@ -81,8 +91,9 @@ std::vector<uint8_t> rareware_comp(std::span<const uint8_t> input) {
 
       dp.update_b(i, 3, 0x12, lzl_memo[i], constant<6>(), lzl);
       dp.update_b(i, 3, 0x12, lzm_memo[i], constant<5>(), lzm);
-      for (size_t l = 3; l <= 0x12; ++l) {
-        dp.update_b(i, l, l, lz_memo[i][l - 3], constant<4>(), lzs);
+      auto res_lz = lz_memo[i].begin();
+      for (size_t l = 3; l <= 0x12; ++l, ++res_lz) {
+        dp.update_b(i, l, l, *res_lz, constant<4>(), lzs);
       }
 
       rlen = encode::run_length_r(input, i, rlen);
@@ -128,7 +139,8 @@ std::vector<uint8_t> rareware_comp(std::span<const uint8_t> input) {
         if (cmd.type == pre16_1) pre16[candidate[0]] += 1;
         else if (cmd.type == pre16s) pre16[candidate[cmd.arg]] += 2;
       }
-      const size_t next_k = num_candidates[iter + 1];
+      next = refine.next_step(iter, iter_total);
+      const size_t next_k = num_candidates[next];
       std::partial_sort(
         candidate.begin(), candidate.begin() + next_k, candidate.end(),
         [&](const uint16_t a, const uint16_t b) { return pre16[a] > pre16[b]; });
@@ -137,6 +149,7 @@ std::vector<uint8_t> rareware_comp(std::span<const uint8_t> input) {
     } else {
       using namespace data_type;
       writer_b4_h ret(0x27);
+      ret.reserve((dp.optimal_cost() + 0x27 * 2 + 1) / 2 + 1);
       size_t adr = 0;
       for (const auto& cmd : dp.optimal_path()) {
         size_t d = adr - cmd.lz_ofs();
@@ -201,7 +214,7 @@ std::vector<uint8_t> rareware_comp(std::span<const uint8_t> input) {
       for (size_t i = 0; i < 2; ++i) ret[i + 1] = pre.rle_b8[i];
       for (size_t i = 0; i < 2; ++i) ret[i + 3] = pre.b8[i];
       for (size_t i = 0; i < 17; ++i) write16(ret.out, 2 * i + 5, candidate[i]);
-      return ret.out;
+      return std::move(ret.out);
     }
   }
 
@@ -26,16 +26,18 @@ std::vector<uint8_t> rayearth_comp(std::span<const uint8_t> input) {
     {0x02ff, 18, 0xc0ff00,   0x0000ff}
   }, 0x03fe);
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, lens.front().min, lens.back().max);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(lens.back().max);
   auto c8 = dp.c<8>(ulens.back().max);
 
+  std::array<encode::lz_data, offsets.size()> lz_memo;
   for (size_t i = input.size(); i-- > 0; ) {
     lz_helper.reset(i);
     dp.update(i, ulens, c8, 0, [&](size_t li) -> tag { return {uncomp, 0, li}; });
+    lz_helper.find_all(i, offsets, lens.front().min, lz_memo);
     dp.update_matrix(i, offsets, lens, c0, 0,
-      [&](size_t oi) { return lz_helper.find(i, offsets[oi].max, lens.front().min); },
+      [&](size_t oi) { return lz_memo[oi]; },
       [&](size_t oi, size_t li) -> tag { return {lz, oi, li}; }
     );
     c0.update(i); c8.update(i);
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+
+#include <chrono>
+#include <limits>
+#include <vector>
+
+#include "options.hpp"
+
+namespace sfc_comp {
+
+// Drives the loops that solve a DP with estimated code lengths, rebuild the codes from the
+// result (e.g. Huffman tables) and solve again:
+//
+//   for (refinement refine; refine.next(); ) {
+//     (solve with the current estimates)
+//     if (refine.improved(cost)) (keep the result and update the estimates)
+//   }
+//
+// A loop ends when an iteration improves the best cost by less than `min_delta`, or at the
+// iteration cap, the time budget or the deadline of the current options. The limits only apply
+// once a result has been kept, so loops that must reach a final step (e.g. fixed candidate
+// schedules) never stop early; such loops use `next_step` to honor the deadline instead.
+// The iteration count and timings are reported to `options::stats`.
+class refinement {
+  using clock = std::chrono::steady_clock;
+
+ public:
+  explicit refinement(size_t min_delta = 1)
+      : min_delta(min_delta), max_iterations(detail::current_options().max_iterations),
+        time_budget(detail::current_options().time_budget) {}
+
+  ~refinement() {
+    if (running) lap();
+    detail::record_refinement(seconds);
+  }
+
+  refinement(const refinement&) = delete;
+  refinement& operator = (const refinement&) = delete;
+
+  // Starts the next iteration, or returns false if the loop should end.
+  bool next() {
+    if (running) lap();
+    if (converged || (kept() && (out_of_budget() || detail::interrupted()))) return false;
+    running = true;
+    return true;
+  }
+
+  // Whether `cost` (of the current iteration) beats the best one by at least `min_delta`.
+  // If not, the loop ends at the next call of `next`.
+  bool improved(size_t cost) {
+    if (kept() && cost + min_delta > best) {
+      converged = true;
+      return false;
+    }
+    best = cost;
+    return true;
+  }
+
+  // Whether another iteration is allowed by the limits.
+  bool out_of_budget() const {
+    if (max_iterations > 0 && seconds.size() >= max_iterations) return true;
+    return time_budget > 0 && elapsed() >= time_budget;
+  }
+
+  // The step after `step` of a schedule of `total` steps whose last step writes the result.
+  // Jumps to the last step once the compression has been interrupted (see `options::deadline`).
+  size_t next_step(size_t step, size_t total) const {
+    if (step + 2 < total && detail::interrupted()) return total - 1;
+    return step + 1;
+  }
+
+  size_t iterations() const { return seconds.size() + (running ? 1 : 0); }
+  size_t best_cost() const { return best; }
+
+ private:
+  bool kept() const { return best != std::numeric_limits<size_t>::max(); }
+
+  double elapsed() const {
+    return std::chrono::duration<double>(clock::now() - start).count();
+  }
+
+  void lap() {
+    const auto now = clock::now();
+    seconds.push_back(std::chrono::duration<double>(now - prev).count());
+    prev = now;
+    running = false;
+  }
+
+  const size_t min_delta;
+  const size_t max_iterations;
+  const double time_budget;
+  const clock::time_point start = clock::now();
+  clock::time_point prev = start;
+  std::vector<double> seconds;
+  size_t best = std::numeric_limits<size_t>::max();
+  bool running = false;
+  bool converged = false;
+};
+
+} // namespace sfc_comp
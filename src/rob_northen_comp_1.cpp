@@ -1,5 +1,7 @@
 #include "algorithm.hpp"
 #include "encode.hpp"
+#include "parallel.hpp"
+#include "refine.hpp"
 #include "utility.hpp"
 #include "writer.hpp"
 
@@ -44,22 +46,26 @@ std::vector<uint8_t> rob_northen_comp_1(std::span<const uint8_t> input) {
   };
 
   const auto lz_memo = [&] {
-    std::vector<std::array<encode::lz_data, lz_offsets.size()>> ret(input.size());
-    lz_helper lz_helper(input);
+    lz_memo_table ret(lz_offsets.size()); ret.reserve(input.size());
+    std::array<encode::lz_data, lz_offsets.size()> res_lz;
+    level_lz_helper lz_helper(input, false, lz_min_len, lz_lens.back().max);
     for (size_t i = 0; i < input.size(); ++i) {
-      encode::lz::find_all(i, lz_offsets, lz_min_len, ret[i], [&](size_t max_ofs) {
-        return lz_helper.find(i, max_ofs, lz_min_len);
-      });
+      lz_helper.find_all(i, lz_offsets, lz_min_len, res_lz);
+      ret.push_back(res_lz);
       lz_helper.add_element(i);
     }
     return ret;
   }();
 
-  using namespace data_type;
-  writer_b16_l ret(0x12); ret.write<bnl>({2, 0});
+  using node_type = layered_solver<tag>::node;
+  struct chunk {
+    std::vector<node_type> commands;
+    rnc1_huff huff;
+    size_t cost;
+  };
 
-  size_t chunk = 0;
-  for (size_t begin = 0; begin < input.size(); ) {
+  // Chunks only share lz_memo, so their codes can be optimized independently.
+  const auto optimize = [&](const size_t begin) {
     // [Todo] Find a reasonable initialization.
     std::vector<vrange> curr_uncomp(ulens.begin(), ulens.end());
     for (size_t k = 0; k < ulens.size(); ++k) curr_uncomp[k].bitlen += k + 1;
@@ -73,17 +79,19 @@ std::vector<uint8_t> rob_northen_comp_1(std::span<const uint8_t> input) {
     const size_t end = std::min(input.size(), begin + chunk_size);
     const size_t size = end - begin;
 
-    using node_type = solver<tag>::node;
-    size_t best_cost = std::numeric_limits<size_t>::max();
     std::vector<node_type> best_commands;
     rnc1_huff best_huff;
 
-    for (bool updated = true; updated; ) {
+    const auto dest = [&](size_t k) { return (k == 1) ? size : size_t(-1); };
+    layered_solver<tag> dp(size, 2, dest);
+    refinement refine;
+    while (refine.next()) {
       const auto shift_lz = [&](const encode::lz_data& p) -> encode::lz_data {
         return {p.ofs - begin, p.len}; // Note: can be negative
       };
 
-      solver<tag> dp0(size, -1), dp1(size);
+      if (refine.iterations() > 1) dp.reset(dest);
+      auto dp0 = dp[0], dp1 = dp[1];
       auto c0_0 = dp0.c<0>(lz_lens.back().max);
       auto c8_1 = dp1.c<8>(ulens.back().max);
 
@@ -93,8 +101,9 @@ std::vector<uint8_t> rob_northen_comp_1(std::span<const uint8_t> input) {
         if (i-- == 0) break;
         dp0.update(i, std::span(curr_uncomp.begin() + 1, curr_uncomp.end()), c8_1, 0,
           [&](size_t li) -> tag { return {uncomp, 0, li + 1}; });
+        const auto lz_row = lz_memo[begin + i];
         dp1.update_matrix(i, curr_lz_ofs, curr_lz_len, c0_0, 0,
-          [&](size_t oi) { return shift_lz(lz_memo[begin + i][oi]); },
+          [&](size_t oi) { return shift_lz(lz_row[oi]); },
           [&](size_t oi, size_t li) -> tag { return {lz, oi, li}; }
         );
         c8_1.update(i);
@@ -113,8 +122,7 @@ std::vector<uint8_t> rob_northen_comp_1(std::span<const uint8_t> input) {
       const auto commands = [&] {
         std::vector<node_type> ret;
         size_t adr = 0;
-        for (size_t ty = 0; adr < size || (adr == size && ty == 0); ty ^= 1) {
-          auto cmd = (ty == 0) ? dp0[adr] : dp1[adr];
+        for (const auto& cmd : dp.optimal_path(0, [](size_t k, const auto&) { return k ^ 1; }, 1)) {
           const auto [tag, oi, li] = cmd.type;
           if (tag == uncomp) counter.ulen[li] += 1;
           else counter.ofs[oi] += 1, counter.len[li] += 1;
@@ -165,28 +173,33 @@ std::vector<uint8_t> rob_northen_comp_1(std::span<const uint8_t> input) {
         update(huff.len, lz_lens, curr_lz_len);
       };
 
-      const size_t chunk_cost = calc_cost(huff, commands, counter);
-      if (chunk_cost < best_cost) {
-        best_cost = chunk_cost;
+      if (refine.improved(calc_cost(huff, commands, counter))) {
         best_commands = std::move(commands);
         best_huff = std::move(huff);
         update_costs(best_huff);
-      } else {
-        updated = false;
       }
     }
+    return chunk{std::move(best_commands), std::move(best_huff), refine.best_cost()};
+  };
 
-    const auto write_bitlens = [&](const encode::huffman_t& huff) {
-      const size_t total_count = max_elem(huff.words) + 1;
-      ret.write<bnl>({5, total_count});
-      for (size_t i = 0; i < total_count; ++i) {
-        ptrdiff_t bits = huff.code[i].bitlen;
-        if (bits <= 0) bits = 0;
-        // this would not happen.
-        if (bits >= 16) throw std::runtime_error("Failed to compress the given data. (bits >= 16)");
-        ret.write<bnl>({4, size_t(bits)});
-      }
-    };
+  using namespace data_type;
+  writer_b16_l ret(0x12); ret.write<bnl>({2, 0});
+
+  const auto write_bitlens = [&](const encode::huffman_t& huff) {
+    const size_t total_count = max_elem(huff.words) + 1;
+    ret.write<bnl>({5, total_count});
+    for (size_t i = 0; i < total_count; ++i) {
+      ptrdiff_t bits = huff.code[i].bitlen;
+      if (bits <= 0) bits = 0;
+      // this would not happen.
+      if (bits >= 16) throw std::runtime_error("Failed to compress the given data. (bits >= 16)");
+      ret.write<bnl>({4, size_t(bits)});
+    }
+  };
+
+  const auto write = [&](const size_t begin, const chunk& best) {
+    [[maybe_unused]] const size_t size = std::min(input.size() - begin, chunk_size);
+    const auto& [best_commands, best_huff, best_cost] = best;
 
     const auto prev_cost = ret.bit_length();
     write_bitlens(best_huff.ulen);
@@ -227,11 +240,13 @@ std::vector<uint8_t> rob_northen_comp_1(std::span<const uint8_t> input) {
     }
     assert(best_cost == ret.bit_length() - prev_cost);
     assert(adr == size);
-    begin = end;
+  };
 
-    ++chunk;
-    if (chunk == 0x100) throw std::runtime_error("This algorithm cannot compress the given data. (chunk >= 0x100)");
-  }
+  const size_t chunks = (input.size() + chunk_size - 1) / chunk_size;
+  if (chunks >= 0x100) throw std::runtime_error("This algorithm cannot compress the given data. (chunk >= 0x100)");
+  parallel::produce_in_order(chunks, parallel::workers(input.size()),
+    [&](size_t c) { return optimize(c * chunk_size); },
+    [&](size_t c, const chunk& result) { write(c * chunk_size, result); });
 
   write32b(ret.out, 0, 0x524e4301);
   write32b(ret.out, 4, input.size());
@@ -239,7 +254,7 @@ std::vector<uint8_t> rob_northen_comp_1(std::span<const uint8_t> input) {
   write16b(ret.out, 12, utility::crc16(input, 0, input.size()));
   write16b(ret.out, 14, utility::crc16(ret.out, 18, ret.size() - 18));
   ret[0x10] = 0; // leeway
-  ret[0x11] = chunk;
+  ret[0x11] = chunks;
 
   return ret.out;
 }
@@ -23,19 +23,21 @@ std::vector<uint8_t> rob_northen_comp_2_core(
     {0x0009, 11, 0b11100000001,  0b00011111111}
   }, 0x00ff);
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 2, len_tab.back().max);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(len_tab.back().max);
   auto c32_4 = dp.c<32, 4>(72);
 
+  std::vector<encode::lz_data> lz_memo(ofs_tab.size());
   for (size_t i = input.size(); i-- > 0; ) {
     lz_helper.reset(i);
     dp.update(i, 1, 9, {uncomp, 0, 0});
     dp.update(i, 12, 12 + 4 * 0x0f, c32_4, 9, {uncompl, 0, 0});
     const auto res_lz2 = lz_helper.find(i, 0x100, 2);
     dp.update(i, 2, 2, res_lz2, c0, 11, {lz2, 0, 0});
+    lz_helper.find_all(i, ofs_tab, len_tab.front().min, lz_memo);
     dp.update_matrix(i, ofs_tab, len_tab, c0, 1,
-      [&](size_t oi) { return lz_helper.find(i, ofs_tab[oi].max, len_tab.front().min); },
+      [&](size_t oi) { return lz_memo[oi]; },
       [&](size_t oi, size_t li) -> tag { return {lz, oi, li}; }
     );
     c0.update(i); c32_4.update(i);
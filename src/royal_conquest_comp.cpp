@@ -2,6 +2,7 @@
 
 #include "algorithm.hpp"
 #include "encode.hpp"
+#include "refine.hpp"
 #include "utility.hpp"
 #include "writer.hpp"
 
@@ -35,12 +36,12 @@ std::vector<uint8_t> royal_conquest_comp(std::span<const uint8_t> in) {
   std::ranges::copy(in, input.begin() + pad);
 
   const auto lz_memo = [&] {
-    std::vector<std::array<encode::lz_data, lz_ofs_tab.size()>> ret(input.size());
-    lz_helper lz_helper(input);
+    lz_memo_table ret(lz_ofs_tab.size()); ret.reserve(input.size());
+    std::array<encode::lz_data, lz_ofs_tab.size()> res_lz;
+    level_lz_helper lz_helper(input, false, lz_min_len, lz_max_len);
     for (size_t i = 0; i < input.size(); ++i) {
-      encode::lz::find_all(i, lz_ofs_tab, lz_min_len, ret[i], [&](size_t max_ofs) {
-        return lz_helper.find(i, max_ofs, lz_min_len);
-      });
+      lz_helper.find_all(i, lz_ofs_tab, lz_min_len, res_lz);
+      ret.push_back(res_lz);
       lz_helper.add_element(i);
     }
     return ret;
@@ -69,8 +70,9 @@ std::vector<uint8_t> royal_conquest_comp(std::span<const uint8_t> in) {
   std::vector<uint8_t> best;
 
   size_t penalty = ilog2(2 * input.size() + 1) + 9;
-  while (true) {
-    solver<tag> dp(input.size());
+  solver<tag> dp(input.size());
+  for (refinement refine; refine.next(); ) {
+    if (refine.iterations() > 1) dp.reset();
 
     for (size_t i = input.size(); i-- > pad; ) {
       dp.update_matrix(i, lz_ofs_tab, lz_lens,
@@ -152,11 +154,8 @@ std::vector<uint8_t> royal_conquest_comp(std::span<const uint8_t> in) {
       write32(ret.out, 0, in.size());
       assert(adr == input.size());
 
-      if (best.empty() || ret.size() < best.size()) {
-        best = std::move(ret.out);
-      } else {
-        break;
-      }
+      if (!refine.improved(ret.size())) break;
+      best = std::move(ret.out);
       update_costs(huff);
     }
   }
@@ -9,7 +9,7 @@ std::vector<uint8_t> sailor_moon_comp_1(std::span<const uint8_t> input) {
   check_size(input.size(), 0, 0x800000);
 
   enum tag { uncomp, lzs, lzls, lzll };
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 2, 256);
   solver<tag> dp(input.size()); auto c0 = dp.c<0>(256);
 
   for (size_t i = input.size(); i-- > 0; ) {
@@ -10,7 +10,7 @@ std::vector<uint8_t> sansara_naga2_comp(std::span<const uint8_t> input) {
 
   enum tag { uncomp, lzs, lzl, lzll };
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 2, 0x4000);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(0x4000);
   auto c1 = dp.c<1>(0x3f);
@@ -27,6 +27,7 @@ std::vector<uint8_t> sansara_naga2_comp(std::span<const uint8_t> input) {
 
   using namespace data_type;
   writer ret(6);
+  ret.reserve(dp.optimal_cost() + 6);
   size_t adr = 0;
   for (const auto& cmd : dp.optimal_path()) {
     const size_t d = adr - cmd.lz_ofs();
@@ -44,7 +45,7 @@ std::vector<uint8_t> sansara_naga2_comp(std::span<const uint8_t> input) {
   write16(ret.out, 4, ret.out.size() - 6);
   assert(dp.optimal_cost() + 6 == ret.size());
   assert(adr == input.size());
-  return ret.out;
+  return std::move(ret.out);
 }
 
 } // namespace sfc_comp
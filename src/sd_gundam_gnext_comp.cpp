@@ -14,7 +14,7 @@ std::vector<uint8_t> sd_gundam_gnext_comp(std::span<const uint8_t> in) {
   std::vector<uint8_t> input(in.size() + pad);
   std::ranges::copy(in, input.begin() + pad);
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 3, 0x21);
   solver<tag> dp(input.size()); auto c0_2 = dp.c<0, 2>(0x21);
 
   for (size_t i = input.size(); i-- > pad; ) {
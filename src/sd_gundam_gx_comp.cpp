@@ -1,7 +1,10 @@
+#include <bit>
+#include <memory>
 #include <numeric>
 
 #include "algorithm.hpp"
 #include "encode.hpp"
+#include "parallel.hpp"
 #include "utility.hpp"
 #include "writer.hpp"
 
@@ -17,35 +20,72 @@ struct shannon_fano {
   std::vector<size_t> bits;
 };
 
+// The cost of a word in the header of a table, which depends on the previous word.
+size_t word_cost(size_t prev_word, size_t word) {
+  static constexpr auto encode_costs = std::to_array<size_t>({
+    2, 3, 3, 6, 6, 6, 6, 6,
+    6, 6, 6, 6, 6, 6, 6, 6,
+    6, 6, 6
+  });
+  if (word <= prev_word || word >= prev_word + 0x14) return 11;
+  return encode_costs[word - prev_word - 1];
+}
+
+// Words of the header that are stored in ascending order.
+struct word_range {
+  size_t cost(size_t prev_word) const {
+    return word_cost(prev_word, first) + inner;
+  }
+
+  size_t first = -1, last = -1;
+  size_t inner = 0; // the cost of the words after the first one
+};
+
+// A word_range that grows one word at a time. The neighbors of a new word are found in a bitset.
+class growing_range {
+ public:
+  static constexpr size_t max_words = 0x200;
+
+  void insert(size_t w) {
+    static constexpr size_t none = -1;
+    assert(w < max_words);
+    size_t pred = none, succ = none;
+    size_t i = w / 64;
+    for (uint64_t m = set[i] & ((uint64_t(1) << (w % 64)) - 1); ; m = set[--i]) {
+      if (m) { pred = i * 64 + 63 - std::countl_zero(m); break; }
+      if (i == 0) break;
+    }
+    i = w / 64;
+    for (uint64_t m = set[i] & (~uint64_t(1) << (w % 64)); ; m = set[++i]) {
+      if (m) { succ = i * 64 + std::countr_zero(m); break; }
+      if (i + 1 == set.size()) break;
+    }
+    if (pred == none) range.first = w;
+    else range.inner += word_cost(pred, w);
+    if (succ == none) range.last = w;
+    else range.inner += word_cost(w, succ);
+    if (pred != none && succ != none) range.inner -= word_cost(pred, succ);
+    set[w / 64] |= uint64_t(1) << (w % 64);
+  }
+
+  word_range range;
+
+ private:
+  std::array<uint64_t, max_words / 64> set = {};
+};
+
 shannon_fano shannon_fano_encode(std::span<const size_t> counts, bool add_header_cost = false) {
   using offset_array = std::array<size_t, 8>;
 
   struct sf_data {
-    sf_data(size_t prefix_len) : prefix_len(prefix_len), bits(1 << prefix_len) {}
+    sf_data(size_t prefix_len) : prefix_len(prefix_len) {}
     size_t cost = std::numeric_limits<size_t>::max();
     size_t prefix_len;
-    std::vector<size_t> bits;
+    std::array<size_t, 8> bits; // the first (1 << prefix_len) elements are used
     offset_array offsets;
     size_t header_cost;
   };
 
-  const auto words_encoding_cost = [&counts](std::span<const size_t> words) {
-    static constexpr auto encode_costs = std::to_array<size_t>({
-      2, 3, 3, 6, 6, 6, 6, 6,
-      6, 6, 6, 6, 6, 6, 6, 6,
-      6, 6, 6
-    });
-    size_t prev_word = counts.size();
-    size_t ret = 0;
-    for (size_t j = 0; j < words.size(); ++j) {
-      size_t word = words[j];
-      if (word <= prev_word || word >= prev_word + 0x14) ret += 11;
-      else ret += encode_costs[word - prev_word - 1];
-      prev_word = word;
-    }
-    return ret;
-  };
-
   const auto bucket_sort = [&](std::span<const size_t> words, const offset_array& offsets,
       std::span<const size_t> bits, std::span<size_t> dest) {
     offset_array ofs; std::ranges::copy(offsets, ofs.begin());
@@ -68,64 +108,104 @@ shannon_fano shannon_fano_encode(std::span<const size_t> counts, bool add_header
   for (size_t i = 0; i < cumu.size(); ++i) cumu[i] = counts[words[i]];
   for (size_t i = cumu.size() - 1; i > 0; --i) cumu[i - 1] += cumu[i];
 
-  offset_array curr_offsets = {};
-  std::array<size_t, 8> curr_bits;
-  std::vector<size_t> curr_words(words.size());
-  std::vector<size_t> word_bits(counts.size());
-
-  std::function<sf_data(size_t, size_t, size_t, size_t, size_t)> solve =
-      [&](size_t now, size_t min_bit, size_t num_words, size_t bit_size, size_t cost) {
+  // The last ranges of tables, i.e. the ones that end at the last word.
+  std::vector<word_range> tails(words.size());
+  if (add_header_cost) {
+    growing_range range;
+    for (size_t begin = words.size(); begin-- > 0; ) {
+      range.insert(words[begin]);
+      tails[begin] = range.range;
+    }
+  }
 
+  // Searches the tables whose prefixes have `min_bit` bits.
+  // The recursion and its pruning are those of a plain exhaustive search, so the result does not
+  // change, but the header cost is accumulated range by range with memoized range costs instead of
+  // being recomputed from the whole table at each leaf.
+  const auto search = [&](const size_t min_bit, const size_t init_cost) {
     const size_t size = 1 << min_bit;
-
-    sf_data ret(min_bit);
-
-    for (size_t b = bit_size; b <= 8; ++b) {
-      const size_t count = 1 << b;
-      curr_offsets[b - 1] = num_words;
-
-      size_t least_num_words = num_words + count * (size - now);
-      if (least_num_words >= words.size()) {
-        if (cost >= ret.cost) break;
-        size_t encode_cost = cost;
-        if (add_header_cost) {
-          for (size_t j = num_words; j < words.size(); ++j) word_bits[words[j]] = b;
-          bucket_sort(ordered_words, curr_offsets, word_bits, curr_words);
-          encode_cost += words_encoding_cost(curr_words);
-        }
-        if (encode_cost < ret.cost) {
-          ret.cost = encode_cost;
-          ret.header_cost = encode_cost - cost;
-          std::fill_n(curr_bits.begin() + now, size - now, b);
-          std::copy_n(curr_bits.begin(), size, ret.bits.begin());
-          std::ranges::copy(curr_offsets, ret.offsets.begin());
-        }
-        break;
+    offset_array curr_offsets = {};
+    std::array<size_t, 8> curr_bits;
+
+    // The header costs of the ranges [num_words, num_words + k * 2^b) (k = 1, 2, ...),
+    // which are shared by all the calls of `solve` with the same `num_words`.
+    struct ranges {
+      growing_range range;
+      std::vector<word_range> costs;
+    };
+    std::vector<std::unique_ptr<ranges>> memo(add_header_cost ? words.size() * 8 : 0);
+    const auto range_cost = [&](size_t num_words, size_t b, size_t k) -> const word_range& {
+      auto& p = memo[num_words * 8 + (b - 1)];
+      if (!p) p = std::make_unique<ranges>();
+      auto& m = *p;
+      while (m.costs.size() < k) {
+        const size_t begin = num_words + (m.costs.size() << b);
+        for (size_t j = begin; j < begin + (size_t(1) << b); ++j) m.range.insert(words[j]);
+        m.costs.push_back(m.range.range);
       }
+      return m.costs[k - 1];
+    };
+
+    const auto solve = [&](const auto& self, size_t now, size_t num_words, size_t bit_size,
+                           size_t cost, size_t header, size_t prev_word) -> sf_data {
+      sf_data ret(min_bit);
+
+      for (size_t b = bit_size; b <= 8; ++b) {
+        const size_t count = 1 << b;
+        curr_offsets[b - 1] = num_words;
+
+        size_t least_num_words = num_words + count * (size - now);
+        if (least_num_words >= words.size()) {
+          if (cost >= ret.cost) break;
+          size_t encode_cost = cost;
+          if (add_header_cost) encode_cost += header + tails[num_words].cost(prev_word);
+          if (encode_cost < ret.cost) {
+            ret.cost = encode_cost;
+            ret.header_cost = encode_cost - cost;
+            std::fill_n(curr_bits.begin() + now, size - now, b);
+            std::copy_n(curr_bits.begin(), size, ret.bits.begin());
+            std::ranges::copy(curr_offsets, ret.offsets.begin());
+          }
+          break;
+        }
 
-      for (size_t i = now; i < size - 1; ++i) {
-        const size_t curr = num_words + count * (i - now), next = curr + count;
-        const size_t ncost = cost + cumu[next];
-        if (ncost >= ret.cost) break;
-        curr_bits[i] = b;
-        if (add_header_cost) {
-          for (size_t j = curr; j < next; ++j) word_bits[words[j]] = b;
+        for (size_t i = now; i < size - 1; ++i) {
+          const size_t curr = num_words + count * (i - now), next = curr + count;
+          const size_t ncost = cost + cumu[next];
+          if (ncost >= ret.cost) break;
+          curr_bits[i] = b;
+          size_t nheader = header, nprev_word = prev_word;
+          if (add_header_cost) {
+            const auto& range = range_cost(num_words, b, i - now + 1);
+            nheader += range.cost(prev_word); nprev_word = range.last;
+            // Every remaining word adds at least 2 bits to the header. If even that bound cannot
+            // beat `ret`, the result of the call would be discarded, so skipping it changes nothing.
+            if (ncost + nheader + 2 * (words.size() - next) >= ret.cost) continue;
+          }
+          auto res = self(self, i + 1, next, b + 1, ncost, nheader, nprev_word);
+          if (res.cost < ret.cost) ret = res;
         }
-        auto res = solve(i + 1, min_bit, next, b + 1, ncost);
-        if (res.cost < ret.cost) ret = std::move(res);
+        cost += cumu[num_words];
+        if (cost >= ret.cost) break;
       }
-      cost += cumu[num_words];
-      if (cost >= ret.cost) break;
-    }
-    return ret;
+      return ret;
+    };
+    return solve(solve, 0, 0, 1, init_cost, 0, counts.size());
   };
 
-  sf_data best_4 = solve(0, 2, 0, 1, 3 * cumu[0] + 4 * 3);
-  sf_data best_8 = solve(0, 3, 0, 1, 4 * cumu[0] + 8 * 3);
-  const sf_data best = std::move((best_4.cost < best_8.cost) ? best_4 : best_8);
+  // The searches for 4 and 8 prefixes are independent.
+  std::array<sf_data, 2> results = {sf_data(2), sf_data(3)};
+  parallel::for_each(2, parallel::workers(2 * cumu[0]), [&](size_t k) {
+    results[k] = (k == 0) ? search(2, 3 * cumu[0] + 4 * 3) : search(3, 4 * cumu[0] + 8 * 3);
+  });
+  auto& [best_4, best_8] = results;
+  const sf_data& best = (best_4.cost < best_8.cost) ? best_4 : best_8;
+  const auto best_bits = std::span(best.bits).first(size_t(1) << best.prefix_len);
 
+  std::vector<size_t> curr_words(words.size());
+  std::vector<size_t> word_bits(counts.size());
   size_t curr = 0;
-  for (const auto b : best.bits) {
+  for (const auto b : best_bits) {
     size_t next = std::min(words.size(), curr + (1 << b));
     for (size_t j = curr; j < next; ++j) word_bits[words[j]] = b;
     curr = next;
@@ -134,8 +214,8 @@ shannon_fano shannon_fano_encode(std::span<const size_t> counts, bool add_header
 
   std::vector<encode::codeword> codewords(counts.size(), {-1, 0});
   curr = 0;
-  for (size_t i = 0; i < best.bits.size(); ++i) {
-    size_t b = best.bits[i];
+  for (size_t i = 0; i < best_bits.size(); ++i) {
+    size_t b = best_bits[i];
     size_t next = std::min(words.size(), curr + (1 << b));
     ptrdiff_t bitlen = best.prefix_len + b;
     for (size_t j = curr; j < next; ++j) codewords[curr_words[j]] = {bitlen, (i << b) | (j - curr)};
@@ -143,7 +223,7 @@ shannon_fano shannon_fano_encode(std::span<const size_t> counts, bool add_header
   }
   return shannon_fano { .words = std::move(curr_words),
                         .codewords = std::move(codewords),
-                        .bits = std::move(best.bits) };
+                        .bits = std::vector<size_t>(best_bits.begin(), best_bits.end()) };
 }
 
 } // namespace
@@ -177,11 +257,9 @@ std::vector<uint8_t> sd_gundam_gx_comp_core(std::span<const uint8_t> input, cons
 
   const auto lz_memo = [&] {
     std::vector<std::array<encode::lz_data, 2>> ret(input.size());
-    lz_helper lz_helper(input);
+    level_lz_helper lz_helper(input, false, lz_min_len, lz_max_len);
     for (size_t i = 0; i < input.size(); ++i) {
-      encode::lz::find_all(i, ofs_tab, lz_min_len, ret[i], [&](size_t max_ofs) {
-        return lz_helper.find(i, max_ofs, lz_min_len);
-      });
+      lz_helper.find_all(i, ofs_tab, lz_min_len, ret[i]);
       lz_helper.add_element(i);
     }
     return ret;
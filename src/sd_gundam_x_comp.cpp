@@ -95,11 +95,9 @@ std::vector<uint8_t> sd_gundam_x_comp(std::span<const uint8_t> input) {
 
   const auto lz_memo = [&] {
     std::vector<std::array<encode::lz_data, 2>> ret(input.size());
-    lz_helper lz_helper(input);
+    level_lz_helper lz_helper(input, false, lz_min_len, lz_max_len);
     for (size_t i = 0; i < input.size(); ++i) {
-      encode::lz::find_all(i, ofs_tab, lz_min_len, ret[i], [&](size_t max_ofs) {
-        return lz_helper.find(i, max_ofs, lz_min_len);
-      });
+      lz_helper.find_all(i, ofs_tab, lz_min_len, ret[i]);
       lz_helper.add_element(i);
     }
     return ret;
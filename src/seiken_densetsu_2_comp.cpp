@@ -10,13 +10,13 @@ std::vector<uint8_t> seiken_densetsu_2_comp(std::span<const uint8_t> input) {
 
   enum tag { uncomp, lz };
 
-  std::vector<uint8_t> best;
-  for (size_t ty = 0; ty < 6; ++ty) {
+  const auto index = level_lz_helper<>::analyze(input);
+  return parallel::best_of(6, input.size(), [&](size_t ty) {
     const size_t min_len = 3;
     const size_t max_len = min_len + (0x007f >> (5 - ty));
     const size_t max_ofs = (0x2000 >> ty);
 
-    lz_helper lz_helper(input, true);
+    level_lz_helper lz_helper(input, index, true, min_len, max_len);
     solver<tag> dp(input.size());
     auto c0 = dp.c<0>(max_len);
     auto c1 = dp.c<1>(0x80);
@@ -30,6 +30,7 @@ std::vector<uint8_t> seiken_densetsu_2_comp(std::span<const uint8_t> input) {
 
     using namespace data_type;
     writer ret; ret.write<d16, d16>(ty, 0);
+    ret.reserve(dp.optimal_cost() + 4);
     size_t adr = 0;
     for (const auto& cmd : dp.optimal_path()) {
       switch (cmd.type) {
@@ -42,9 +43,8 @@ std::vector<uint8_t> seiken_densetsu_2_comp(std::span<const uint8_t> input) {
     write16b(ret.out, 1, input.size());
     assert(adr == input.size());
     assert(dp.optimal_cost() + 4 == ret.size());
-    if (best.empty() || ret.size() < best.size()) best = std::move(ret.out);
-  }
-  return best;
+    return std::move(ret.out);
+  });
 }
 
 } // namespace sfc_comp
@@ -8,7 +8,7 @@ namespace sfc_comp {
 std::vector<uint8_t> shin_megami_tensei2_comp(std::span<const uint8_t> input) {
   enum tag { uncomp, rle0, rle0l, rle, lz, common16 };
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 2, 0x21);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(0x11f);
   auto c1 = dp.c<1>(32);
@@ -36,6 +36,7 @@ std::vector<uint8_t> shin_megami_tensei2_comp(std::span<const uint8_t> input) {
 
   using namespace data_type;
   writer ret;
+  ret.reserve(dp.optimal_cost() + 2);
   size_t adr = 0;
   for (const auto& cmd : dp.optimal_path()) {
     size_t d = adr - cmd.lz_ofs();
@@ -56,7 +57,7 @@ std::vector<uint8_t> shin_megami_tensei2_comp(std::span<const uint8_t> input) {
   ret.write<d16b>(0x7fff);
   assert(dp.optimal_cost() + 2 == ret.size());
   assert(adr == input.size());
-  return ret.out;
+  return std::move(ret.out);
 }
 
 } // namespace sfc_comp
@@ -15,7 +15,7 @@ std::vector<uint8_t> slap_stick_comp(std::span<const uint8_t> in) {
   std::vector<uint8_t> input(in.size() + pad, 0x20);
   std::ranges::copy(in, input.begin() + pad);
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 2, 0x11);
   solver<tag> dp(input.size()); auto c0 = dp.c<0>(0x11);
 
   for (size_t i = input.size(); i-- > pad; ) {
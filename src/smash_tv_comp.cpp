@@ -24,7 +24,7 @@ std::vector<uint8_t> smash_tv_comp_core(std::span<const uint8_t> input) {
     return vrange((1 << i) + lz_min_len - 1, (2 << i) + lz_min_len - 2, 2 * i + 1, 0);
   });
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, lz_lens.front().min, lz_lens.back().max);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(lz_lens.back().max);
   auto c8 = dp.c<8>(uncomp_lens.back().max);
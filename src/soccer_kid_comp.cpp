@@ -11,7 +11,7 @@ std::vector<uint8_t> soccer_kid_comp(std::span<const uint8_t> in) {
 
   std::vector<uint8_t> input(in.rbegin(), in.rend());
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 2, 256);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(256);
   auto c8 = dp.c<8>(9 + 0xff);
@@ -39,7 +39,7 @@ std::vector<uint8_t> soul_and_sword_comp(std::span<const uint8_t> input) {
     {0x0089, 20, 0b1111111111101'0000000},
   }, 0x00ff);
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, lz_len_tab.front().min, lz_len_tab.back().max);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(lz_len_tab.back().max);
   auto c8 = dp.c<8>(uncomp_len_tab.back().max);
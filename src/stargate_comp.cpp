@@ -28,7 +28,7 @@ std::vector<uint8_t> stargate_comp_core(std::span<const uint8_t> input, const bo
     throw std::runtime_error("This algorithm may not be able to compress the given data.");
   }
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, lz_lens.front().min, lz_lens.back().max);
   solver<tag> dp0(input.size()), dp1(input.size());
   auto c0_0 = dp0.c<0>(lz_lens.back().max);
   auto c8_1 = dp1.c<8>(uncomp_lens.back().max);
@@ -11,7 +11,7 @@ std::vector<uint8_t> super_4wd_the_baja_comp(std::span<const uint8_t> in) {
 
   std::vector<uint8_t> input(in.rbegin(), in.rend());
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 2, 5 + 0xff);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(5 + 0xff);
   auto c8 = dp.c<8>(9 + 0xff);
@@ -42,6 +42,7 @@ std::vector<uint8_t> super_bomberman_5_comp(std::span<const uint8_t> in) {
 
   using namespace data_type;
   writer ret;
+  ret.reserve(dp.optimal_cost(pad));
   size_t adr = pad;
   for (const auto& cmd : dp.optimal_path(pad)) {
     switch (cmd.type) {
@@ -55,7 +56,7 @@ std::vector<uint8_t> super_bomberman_5_comp(std::span<const uint8_t> in) {
   assert(dp.optimal_cost(pad) == ret.size());
   assert(adr == input.size());
 
-  return ret.out;
+  return std::move(ret.out);
 }
 
 } // namespace sfc_comp
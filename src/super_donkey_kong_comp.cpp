@@ -17,7 +17,7 @@ std::vector<uint8_t> super_donkey_kong_comp(std::span<const uint8_t> input) {
   auto candidate = utility::k_most_freq_u16(input, num_candidates[0]);
   std::vector<int64_t> pre(0x10000, -1);
 
-  lz_helper lz_helper(input);
+  level_lz_helper lz_helper(input, false, 3, 0x100);
   std::vector<encode::lz_data> lz_memo(input.size());
   for (size_t i = 0; i < input.size(); ++i) {
     lz_memo[i] = lz_helper.find(i, 0xffff, 3);
@@ -60,6 +60,7 @@ std::vector<uint8_t> super_donkey_kong_comp(std::span<const uint8_t> input) {
     } else {
       using namespace data_type;
       writer ret;
+      ret.reserve(dp.optimal_cost() + 0x80 + 1);
       for (size_t i = 0; i < 64; ++i) ret.write<d16>(0);
       size_t adr = 0;
       for (const auto& cmd : dp.optimal_path()) {
@@ -76,7 +77,7 @@ std::vector<uint8_t> super_donkey_kong_comp(std::span<const uint8_t> input) {
       assert(dp.optimal_cost() + 0x80 == ret.size());
       assert(adr == input.size());
       ret.write<d8>(0);
-      return ret.out;
+      return std::move(ret.out);
     }
   }
 
@@ -16,7 +16,7 @@ std::vector<uint8_t> super_robot_wars_comp_core(
     throw std::logic_error("skipped_size exceeds the input size.");
   }
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 2, lz_max_len);
   solver<tag> dp(input.size()); auto c0 = dp.c<0>(lz_max_len);
 
   for (size_t i = input.size(); i-- > skipped_size; ) {
@@ -4,8 +4,7 @@ namespace sfc_comp {
 
 std::vector<uint8_t> super_soukoban_comp(std::span<const uint8_t> input) {
   check_size(input.size(), 1, 0xffff);
-  std::vector<uint8_t> best;
-  for (size_t comp_ty = 0; comp_ty < 4; ++comp_ty) {
+  auto best = parallel::best_of(4, input.size(), [&](size_t comp_ty) {
     const size_t min_len = 3;
     const size_t max_len = min_len + ((0x10 << comp_ty) - 1);
     const size_t max_ofs = 0x1000 >> comp_ty;
@@ -20,11 +19,9 @@ std::vector<uint8_t> super_soukoban_comp(std::span<const uint8_t> input) {
       }
     );
     compressed[0] = comp_ty;
-    if (best.empty() || compressed.size() < best.size()) {
-      best = std::move(compressed);
-    }
-  }
-  if (best.empty() || best.size() >= input.size() + 1) {
+    return compressed;
+  });
+  if (best.size() >= input.size() + 1) {
     best.resize(input.size() + 1);
     std::ranges::copy(input, best.begin() + 1);
     best[0] = 0x04;
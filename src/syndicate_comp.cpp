@@ -1,3 +1,5 @@
+#include <tuple>
+
 #include "algorithm.hpp"
 #include "encode.hpp"
 #include "utility.hpp"
@@ -28,11 +30,9 @@ std::vector<uint8_t> syndicate_comp(std::span<const uint8_t> input) {
   const auto [lz_memo, longest_lz_len, longest_lz_dist] = [&] {
     size_t longest_lz_len = 0, longest_lz_dist = 0;
     std::vector<std::array<encode::lz_data, max_offsets.size()>> ret(input.size());
-    lz_helper lz_helper(input);
+    level_lz_helper lz_helper(input, false, lz_min_len, input.size());
     for (size_t i = 0; i < input.size(); ++i) {
-      encode::lz::find_all(i, max_offsets, lz_min_len, ret[i], [&](size_t max_ofs) {
-        return lz_helper.find(i, max_ofs, lz_min_len);
-      });
+      lz_helper.find_all(i, max_offsets, lz_min_len, ret[i]);
       if (const auto lz = ret[i].back(); lz.len >= lz_min_len) {
         longest_lz_len = std::max(longest_lz_len, lz.len);
         longest_lz_dist = std::max(longest_lz_dist, i - lz.ofs);
@@ -50,30 +50,31 @@ std::vector<uint8_t> syndicate_comp(std::span<const uint8_t> input) {
       const size_t max_len = min_lens[lb + ob] + ((size_t(1) << lb) - 1);
       if (longest_lz_len > max_len) lb_lim = lb + 1;
     }
-    std::vector<solver<tag>> dp(lb_lim + 1);
-    for (size_t lb = lb_min; lb <= lb_lim; ++lb) dp[lb] = solver<tag>(input.size());
-    std::vector<decltype(dp[0].c<0>(0))> c0s(lb_lim + 1);
-    for (size_t lb = lb_min; lb <= lb_lim; ++lb) c0s[lb] = dp[lb].c<0>(((1 << lb) - 1) + 3);
+    layered_solver<tag> dp_layers(input.size(), lb_lim - lb_min + 1);
+    const auto dp = [&](size_t lb) { return dp_layers[lb - lb_min]; };
+    std::vector<decltype(dp(lb_min).c<0>(0))> c0s(lb_lim + 1);
+    for (size_t lb = lb_min; lb <= lb_lim; ++lb) c0s[lb] = dp(lb).c<0>(((1 << lb) - 1) + 3);
 
     for (size_t i = input.size(); i-- > 0; ) {
       for (size_t lb = lb_min; lb <= lb_lim; ++lb) {
-        dp[lb].update(i, 1, 9, {uncomp, lb});
+        auto dpl = dp(lb);
+        dpl.update(i, 1, 9, {uncomp, lb});
         const size_t lbs = std::max(lb_min, lb - 1), lbl = std::min(lb_lim, lb + 1);
         const size_t mn = min_lens[lb + ob];
         const size_t hi = len_masks[lb], lo = (hi & -hi), mx = (hi | (lo - 1));
         const auto res_lz = lz_memo[i][ob];
         const size_t c = 1 + lb + ob;
-        dp[lb].update(i, mn,      mn + lo - 1, res_lz, c0s[lbs], c, {lz, lbs});
-        dp[lb].update(i, mn + lo, mn + hi - 1, res_lz, c0s[lb],  c, {lz, lb});
-        dp[lb].update(i, mn + hi, mn + mx    , res_lz, c0s[lbl], c, {lz, lbl});
+        dpl.update(i, mn,      mn + lo - 1, res_lz, c0s[lbs], c, {lz, lbs});
+        dpl.update(i, mn + lo, mn + hi - 1, res_lz, c0s[lb],  c, {lz, lb});
+        dpl.update(i, mn + hi, mn + mx    , res_lz, c0s[lbl], c, {lz, lbl});
       }
       for (size_t lb = lb_min; lb <= lb_lim; ++lb) c0s[lb].update(i);
     }
 
     const auto [best_lb, min_cost] = [&] {
-      size_t best_lb = -1, best = dp[lb_min].infinite_cost;
+      size_t best_lb = -1, best = dp_layers.infinite_cost;
       for (size_t lb = lb_min; lb <= lb_lim; ++lb) {
-        if (dp[lb].optimal_cost() < best) best = dp[lb].optimal_cost(), best_lb = lb;
+        if (dp(lb).optimal_cost() < best) best = dp(lb).optimal_cost(), best_lb = lb;
       }
       return std::make_pair(best_lb, best);
     }();
@@ -82,8 +83,9 @@ std::vector<uint8_t> syndicate_comp(std::span<const uint8_t> input) {
     writer_b8_l ret(4);
 
     size_t adr = 0;
-    for (size_t lb = best_lb; adr < input.size(); ) {
-      const auto& cmd = dp[lb][adr];
+    const auto next_layer = [](size_t, const auto& cmd) -> size_t { return cmd.type.li - lb_min; };
+    for (const auto& cmd : dp_layers.optimal_path(best_lb - lb_min, next_layer)) {
+      size_t lb = cmd.layer + lb_min;
       const auto [tag, li] = cmd.type;
       switch (tag) {
       case uncomp: {
@@ -10,7 +10,7 @@ std::vector<uint8_t> tactics_ogre_comp_1(std::span<const uint8_t> input) {
 
   enum tag { uncomp, rle0, lzs, lzl };
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 3, 0x43);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(0x43);
   auto c1 = dp.c<1>(0x40);
@@ -28,6 +28,7 @@ std::vector<uint8_t> tactics_ogre_comp_1(std::span<const uint8_t> input) {
 
   using namespace data_type;
   writer ret(2);
+  ret.reserve(dp.optimal_cost() + 2);
   size_t adr = 0;
   for (const auto& cmd : dp.optimal_path()) {
     const size_t d = adr - cmd.lz_ofs();
@@ -44,7 +45,7 @@ std::vector<uint8_t> tactics_ogre_comp_1(std::span<const uint8_t> input) {
   write16(ret.out, 0, input.size());
   assert(dp.optimal_cost() + 2 == ret.size());
   assert(adr == input.size());
-  return ret.out;
+  return std::move(ret.out);
 }
 
 } // namespace sfc_comp
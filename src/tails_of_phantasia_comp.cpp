@@ -11,8 +11,9 @@ std::vector<uint8_t> tales_of_phantasia_comp(std::span<const uint8_t> input) {
   enum tag { uncomp, rle, rlel, lz };
 
   std::vector<uint8_t> best;
+  const auto index = level_lz_helper<>::analyze(input);
   for (size_t comp_type = 0x81; comp_type <= 0x83; comp_type += 2) {
-    lz_helper lz_helper(input, true);
+    level_lz_helper lz_helper(input, index, true, 3, 0x12);
     solver<tag> dp(input.size()); auto c0 = dp.c<0>(0x13 + 0xff);
 
     size_t rlen = 0;
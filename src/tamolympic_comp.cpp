@@ -31,12 +31,13 @@ std::vector<uint8_t> tamolympic_comp(std::span<const uint8_t> input) {
     {0x3f00, 21, 0b1010101010100, 0b0101010101011}
   }, 0xbeff);
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 2, len_tab.back().max);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(len_tab.back().max);
   auto c8 = dp.c<8>(0x14 + 0xff);
 
   size_t rlen = 0;
+  std::vector<encode::lz_data> lz_memo(ofs_tab.size());
   for (size_t i = input.size(); i-- > 0; ) {
     lz_helper.reset(i);
 
@@ -59,8 +60,9 @@ std::vector<uint8_t> tamolympic_comp(std::span<const uint8_t> input) {
       }
     }
 
+    lz_helper.find_all(i, ofs_tab, len_tab.front().min, lz_memo);
     dp.update_matrix(i, ofs_tab, len_tab, c0, 2,
-      [&](size_t oi) { return lz_helper.find(i, ofs_tab[oi].max, len_tab.front().min); },
+      [&](size_t oi) { return lz_memo[oi]; },
       [&](size_t oi, size_t li) -> tag { return {lz, oi, li}; }
     );
 
@@ -2,6 +2,7 @@
 
 #include <cstddef>
 
+#include <algorithm>
 #include <numeric>
 #include <stdexcept>
 #include <string>
@@ -34,10 +34,14 @@ std::vector<uint8_t> vortex_comp(std::span<const uint8_t> in) {
 
   std::vector<uint8_t> input(in.rbegin(), in.rend());
 
-  lz_helper lz_helper(input, true);
-  solver<tag> dp0(input.size(), -1); auto c0_0 = dp0.c<0>(len_tab.back().max);
-  solver<tag> dp1(input.size()); auto c8_1 = dp1.c<8>(ulen_tab.back().max);
-
+  level_lz_helper lz_helper(input, true, 2, len_tab.back().max);
+  layered_solver<tag, size_t, uint16_t> dp(input.size(), 2, [&](size_t k) {
+    return (k == 1) ? input.size() : size_t(-1);
+  });
+  auto dp0 = dp[0]; auto c0_0 = dp0.c<0>(len_tab.back().max);
+  auto dp1 = dp[1]; auto c8_1 = dp1.c<8>(ulen_tab.back().max);
+
+  std::array<encode::lz_data, ofs_tab.size()> lz_memo;
   for (size_t i = input.size(); ; ) {
     dp0.update_c(i, 0, dp1[i].cost + 3, {none, 0, 0});
     c0_0.update(i);
@@ -51,8 +55,9 @@ std::vector<uint8_t> vortex_comp(std::span<const uint8_t> in) {
     dp1.update(i, 2, 2, res_lzs, c0_0, 10, {lz2, 0, 0});
     dp1.update(i, 3, 3, res_lzs, c0_0, 11, {lz3, 0, 0});
     dp1.update(i, 3, 3, lz_helper.find(i, 0x3fff, 3),  c0_0, 17, {lz3, 1, 0});
+    lz_helper.find_all(i, ofs_tab, len_tab.front().min, lz_memo);
     dp1.update_matrix(i, ofs_tab, len_tab, c0_0, 0,
-      [&](size_t oi) { return lz_helper.find(i, ofs_tab[oi].max, len_tab.front().min); },
+      [&](size_t oi) { return lz_memo[oi]; },
       [&](size_t oi, size_t li) -> tag { return {lz, oi, li}; }
     );
     c8_1.update(i);
@@ -66,9 +71,7 @@ std::vector<uint8_t> vortex_comp(std::span<const uint8_t> in) {
   using namespace data_type;
   writer_b8_l ret(4); ret.write<b1>(false);
   size_t adr = 0;
-  for (size_t curr = 0; adr <= input.size(); curr ^= 1) {
-    if (adr == input.size() && curr == 1) break;
-    const auto& cmd = (curr == 0) ? dp0[adr] : dp1[adr];
+  for (const auto& cmd : dp.optimal_path(0, [](size_t k, const auto&) { return k ^ 1; }, 1)) {
     const auto [tag, oi, li] = cmd.type;
     const size_t d = adr - cmd.lz_ofs();
     switch (tag) {
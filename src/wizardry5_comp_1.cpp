@@ -8,14 +8,14 @@ namespace sfc_comp {
 std::vector<uint8_t> wizardry5_comp_1(std::span<const uint8_t> input) {
   enum tag { uncomp0, uncomp, lz };
 
-  lz_helper lz_helper(input, true);
-  solver<tag> dp(input.size());
-
   static constexpr auto lz_lens = std::to_array<size_t>({
     2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 16, 32, 64, 128, 256
   });
   static constexpr auto len_code = inverse_map<lz_lens.back() + 1>(lz_lens);
 
+  level_lz_helper lz_helper(input, true, lz_lens.front(), lz_lens.back());
+  solver<tag> dp(input.size());
+
   for (size_t i = input.size(); i-- > 0; ) {
     lz_helper.reset(i);
     if (input[i] == 0) dp.update(i, 1, 5, uncomp0);
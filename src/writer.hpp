@@ -2,7 +2,9 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cassert>
 
+#include <algorithm>
 #include <fstream>
 #include <vector>
 
@@ -101,6 +103,16 @@ class writer {
     return out.size();
   }
 
+  // Reserves the final size (e.g. from the cost of the DP) so that `out` grows without reallocation.
+  void reserve(size_t s) {
+    out.reserve(s);
+  }
+
+  // Opens a gap of `n` zero bytes at `pos`, e.g. for a header that precedes bytes already written.
+  void insert(size_t pos, size_t n) {
+    out.insert(out.begin() + pos, n, 0);
+  }
+
   void extend(std::span<const uint8_t> v) {
     out.insert(out.end(), v.begin(), v.end());
   }
@@ -324,6 +336,21 @@ class bitstream_writer : public writer {
     return size() * 8 - bit;
   }
 
+  void insert(size_t pos, size_t n) {
+    writer::insert(pos, n);
+    if (bits_pos != size_t(-1) && bits_pos >= pos) bits_pos += n;
+  }
+
+  // Reverses the order of the blocks (keeping the bytes of each block) from `begin` to the end,
+  // for streams that are read backward. The bytes from `begin` must consist of whole blocks.
+  void reverse_blocks(size_t begin) {
+    assert((size() - begin) % BlockBytes == 0);
+    if (size() - begin < 2 * BlockBytes) return;
+    for (size_t i = begin, j = size() - BlockBytes; i < j; i += BlockBytes, j -= BlockBytes) {
+      std::swap_ranges(out.begin() + i, out.begin() + i + BlockBytes, out.begin() + j);
+    }
+  }
+
  protected:
   using writer::write_;
 
@@ -348,15 +375,13 @@ class bitstream_writer : public writer {
   }
 
   void write_(const data_type::bnl& d) {
-    for (size_t i = 0; i < d.n; ++i) {
-      write<data_type::b1>((d.v >> i) & 1);
-    }
+    if constexpr (LSBFirst) write_bits(d.v, d.n);
+    else write_bits(reverse_bits(d.v, d.n), d.n);
   }
 
   void write_(const data_type::bnh& d) {
-    for (size_t i = 0; i < d.n; ++i) {
-      write<data_type::b1>((d.v >> (d.n - 1 - i)) & 1);
-    }
+    if constexpr (LSBFirst) write_bits(reverse_bits(d.v, d.n), d.n);
+    else write_bits(d.v, d.n);
   }
 
   void write_(const data_type::b8ln& d) {
@@ -367,6 +392,40 @@ class bitstream_writer : public writer {
     for (const auto v : d.v) write<data_type::bnh>({8, v});
   }
 
+ private:
+  // Writes the lowest `n` (<= 64) bits of `v` in the order of the blocks, i.e. from bit 0 if
+  // LSBFirst and from bit n - 1 otherwise. Each block is filled by one shift instead of bit by bit.
+  void write_bits(uint64_t v, size_t n) {
+    while (n > 0) {
+      if constexpr (!PreRead) write(data_type::none());
+      assert(bit > 0);
+      const size_t k = std::min(n, bit);
+      const uint64_t mask = (uint64_t(1) << k) - 1;
+      uint64_t chunk;
+      size_t shift;
+      if constexpr (LSBFirst) {
+        chunk = v & mask; v >>= k;
+        shift = block_bitsize - bit;
+      } else {
+        chunk = (v >> (n - k)) & mask;
+        shift = bit - k;
+      }
+      chunk <<= shift;
+      for (size_t i = 0; i < BlockBytes; ++i) out[bits_pos + i] |= chunk >> (8 * i);
+      bit -= k; n -= k;
+      if constexpr (PreRead) write(data_type::none());
+    }
+  }
+
+  static uint64_t reverse_bits(uint64_t v, size_t n) {
+    if (n == 0) return 0;
+    v = (v & 0x5555'5555'5555'5555) << 1 | ((v >> 1) & 0x5555'5555'5555'5555);
+    v = (v & 0x3333'3333'3333'3333) << 2 | ((v >> 2) & 0x3333'3333'3333'3333);
+    v = (v & 0x0f0f'0f0f'0f0f'0f0f) << 4 | ((v >> 4) & 0x0f0f'0f0f'0f0f'0f0f);
+    v = __builtin_bswap64(v);
+    return v >> (64 - n);
+  }
+
  public:
   size_t bit;
   size_t bits_pos;
@@ -14,7 +14,7 @@ std::vector<uint8_t> zelda_comp_core(std::span<const uint8_t> input, const bool
   using tag = tag_l<method>;
   static constexpr auto lens = to_vranges({{0x0001, 1, 0}, {0x0021, 2, 0}}, 0x0400);
 
-  lz_helper lz_helper(input, true);
+  level_lz_helper lz_helper(input, true, 3, lens.back().max);
   solver<tag> dp(input.size());
   auto c0 = dp.c<0>(lens.back().max);
   auto c1 = dp.c<1>(lens.back().max);
@@ -37,6 +37,7 @@ std::vector<uint8_t> zelda_comp_core(std::span<const uint8_t> input, const bool
 
   using namespace data_type;
   writer ret;
+  ret.reserve(dp.optimal_cost() + 1);
   size_t adr = 0;
   for (const auto& cmd : dp.optimal_path()) {
     const auto [tag, li] = cmd.type;
@@ -58,7 +59,7 @@ std::vector<uint8_t> zelda_comp_core(std::span<const uint8_t> input, const bool
   assert(dp.optimal_cost() == ret.size());
   assert(adr == input.size());
   ret.write<d8>(0xff);
-  return ret.out;
+  return std::move(ret.out);
 }
 
 } // namespace